@@ -1,11 +1,18 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <queue>
+#include <random>
 #include <unordered_map>
 #include <functional>
 #include <vector>
 
 using namespace std;
 
+// Two heaps + lazy deletion (delayed map). O(log n) per step, but an evicted value is only
+// popped once it reaches a heap top, so stale entries can pile up far beyond the window
+// (e.g. rising input: the evicted values sink to the bottom of `low` and stay there).
 class SlidingMedian
 {
 
@@ -61,29 +68,27 @@ class SlidingMedian
         }
     }
 
+    // Tops are kept live (pruned) after every operation, so they can be compared against.
     void rebalance(){
         if (lowSize > highSize + 1)
         {
-            pruneLow();
-            long long x = low.top();
+            high.push(low.top());
             low.pop();
             lowSize--;
-
-            high.push(x);
             highSize++;
+            pruneLow();
         }else if(highSize > lowSize){
-            pruneHigh();
-            long long x = high.top();
+            low.push(high.top());
             high.pop();
             highSize--;
-            low.push(x);
             lowSize++;
+            pruneHigh();
         }
-        
+
     }
     public:
      void insert(long long x){
-        if (!low.empty() || x < low.top())
+        if (low.empty() || x <= low.top())
         {
             low.push(x);
             lowSize++;
@@ -94,43 +99,312 @@ class SlidingMedian
         rebalance();
      }
 
-     void erase(long long){
+     // x must be in the window.
+     void erase(long long x){
 
         delayed[x]++;
-        pruneLow();
 
-        if (!low.empty() && x <= low.top())
+        if (x <= low.top())
         {
             lowSize--;
-            if (!low.empty() && x == low.top())
+            if (x == low.top())
             {
                 pruneLow();
-            }else{
-                highSize--;
-                if (!high.empty() && x == high.top())
-                {
-                    pruneHigh();
-                }
             }
-            rebalance();
+        }else{
+            highSize--;
+            if (x == high.top())
+            {
+                pruneHigh();
+            }
         }
+        rebalance();
      }
 
-    double getMedian(int k){
-        pruneLow();
-        pruneHigh();
-
-        if (k%2 ==1)
+    double getMedian(){
+        if ((lowSize + highSize) % 2 == 1)
         {
             return(double) low.top();
         }
         return ((double)low.top() + (double)high.top()) /2.0;
-        
+
+    }
+
+    // Heap entries held, stale ones included.
+    size_t footprint() const { return low.size() + high.size(); }
+};
+
+// Order-statistic treap: each node holds a distinct value with its multiplicity and the
+// number of values in its subtree, so insert, erase and k-th smallest are all O(log n)
+// expected. Nodes live in one vector and are recycled through a free list: erase really
+// removes a value, so memory tracks the live set (no tombstones) and steady-state sliding
+// does no allocation.
+class OrderStatisticTree
+{
+    struct Node
+    {
+        long long key;
+        uint32_t prio;
+        uint32_t left, right; // 0 = none (pool[0] is a sentinel)
+        uint32_t count;       // copies of key
+        uint32_t size;        // values in this subtree, copies included
+    };
+
+    vector<Node> pool{Node{0, 0, 0, 0, 0, 0}};
+    vector<uint32_t> freeList;
+    uint32_t root = 0;
+    uint32_t seed = 2463534242u;
+
+    uint32_t nextPrio()
+    {
+        seed ^= seed << 13; // xorshift32
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    uint32_t newNode(long long key)
+    {
+        uint32_t n;
+        if (!freeList.empty())
+        {
+            n = freeList.back();
+            freeList.pop_back();
+        }
+        else
+        {
+            n = (uint32_t)pool.size();
+            pool.emplace_back();
+        }
+        pool[n] = Node{key, nextPrio(), 0, 0, 1, 1};
+        return n;
+    }
+
+    void update(uint32_t t)
+    {
+        pool[t].size = pool[pool[t].left].size + pool[pool[t].right].size + pool[t].count;
+    }
+
+    uint32_t rotateRight(uint32_t t)
+    {
+        uint32_t l = pool[t].left;
+        pool[t].left = pool[l].right;
+        pool[l].right = t;
+        update(t);
+        update(l);
+        return l;
+    }
+
+    uint32_t rotateLeft(uint32_t t)
+    {
+        uint32_t r = pool[t].right;
+        pool[t].right = pool[r].left;
+        pool[r].left = t;
+        update(t);
+        update(r);
+        return r;
+    }
+
+    uint32_t insertAt(uint32_t t, long long key)
+    {
+        if (t == 0) return newNode(key);
+        if (key == pool[t].key)
+        {
+            pool[t].count++;
+            pool[t].size++;
+            return t;
+        }
+        if (key < pool[t].key)
+        {
+            uint32_t l = insertAt(pool[t].left, key);
+            pool[t].left = l;
+            if (pool[l].prio > pool[t].prio) return rotateRight(t);
+        }
+        else
+        {
+            uint32_t r = insertAt(pool[t].right, key);
+            pool[t].right = r;
+            if (pool[r].prio > pool[t].prio) return rotateLeft(t);
+        }
+        update(t);
+        return t;
+    }
+
+    // Removes one copy of key (must be present).
+    uint32_t eraseAt(uint32_t t, long long key)
+    {
+        if (key < pool[t].key)
+        {
+            pool[t].left = eraseAt(pool[t].left, key);
+        }
+        else if (pool[t].key < key)
+        {
+            pool[t].right = eraseAt(pool[t].right, key);
+        }
+        else if (pool[t].count > 1)
+        {
+            pool[t].count--;
+        }
+        else
+        {
+            // Rotate the node down until it has at most one child, then splice it out.
+            uint32_t l = pool[t].left, r = pool[t].right;
+            if (l == 0 || r == 0)
+            {
+                freeList.push_back(t);
+                return l ? l : r;
+            }
+            if (pool[l].prio > pool[r].prio)
+            {
+                t = rotateRight(t);
+                pool[t].right = eraseAt(pool[t].right, key);
+            }
+            else
+            {
+                t = rotateLeft(t);
+                pool[t].left = eraseAt(pool[t].left, key);
+            }
+        }
+        update(t);
+        return t;
+    }
+
+public:
+    void insert(long long key) { root = insertAt(root, key); }
+
+    // key must be present.
+    void erase(long long key) { root = eraseAt(root, key); }
+
+    size_t size() const { return pool[root].size; }
+
+    // k-th smallest, 0-based; k < size().
+    long long kth(size_t k) const
+    {
+        uint32_t t = root;
+        for (;;)
+        {
+            uint32_t leftSize = pool[pool[t].left].size;
+            if (k < leftSize)
+            {
+                t = pool[t].left;
+            }
+            else if (k < leftSize + pool[t].count)
+            {
+                return pool[t].key;
+            }
+            else
+            {
+                k -= leftSize + pool[t].count;
+                t = pool[t].right;
+            }
+        }
     }
+
+    // Nodes allocated, free ones included: the structure's high-water mark.
+    size_t footprint() const { return pool.size() - 1; }
 };
+
+// Rolling median / percentiles over the last `window` samples (e.g. request latencies).
+// A ring buffer remembers arrival order for eviction; the tree answers rank queries.
+class SlidingWindowPercentile
+{
+    OrderStatisticTree tree;
+    vector<long long> ring; // the window in arrival order, oldest at `next` once full
+    size_t next = 0;
+    size_t capacity;
+
+public:
+    explicit SlidingWindowPercentile(size_t window) : capacity(window) { ring.reserve(window); }
+
+    // Adds a sample, evicting the oldest once the window is full.
+    void add(long long x)
+    {
+        if (ring.size() < capacity)
+        {
+            ring.push_back(x);
+        }
+        else
+        {
+            tree.erase(ring[next]);
+            ring[next] = x;
+            next = (next + 1) % capacity;
+        }
+        tree.insert(x);
+    }
+
+    size_t size() const { return tree.size(); }
+
+    // Window must not be empty.
+    double median() const
+    {
+        size_t n = tree.size();
+        if (n % 2 == 1) return (double)tree.kth(n / 2);
+        return ((double)tree.kth(n / 2 - 1) + (double)tree.kth(n / 2)) / 2.0;
+    }
+
+    // Nearest-rank percentile, q in [0, 1]: p50, p99, ... Window must not be empty.
+    long long percentile(double q) const
+    {
+        size_t n = tree.size();
+        size_t rank = (size_t)ceil(q * (double)n);
+        return tree.kth(rank > 0 ? rank - 1 : 0);
+    }
+
+    size_t footprint() const { return tree.footprint(); }
+};
+
+// Slides both engines over the same samples; checks they agree and reports time per sample
+// and peak memory footprint (entries held).
+static void bench(const char* name, const vector<long long>& samples, size_t window)
+{
+    using Clock = chrono::steady_clock;
+
+    SlidingMedian heaps;
+    double heapSum = 0;
+    size_t heapPeak = 0;
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        heaps.insert(samples[i]);
+        if (i >= window) heaps.erase(samples[i - window]);
+        if (i + 1 >= window) heapSum += heaps.getMedian();
+        heapPeak = max(heapPeak, heaps.footprint());
+    }
+    auto t1 = Clock::now();
+
+    SlidingWindowPercentile tree(window);
+    double treeSum = 0;
+    auto t2 = Clock::now();
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        tree.add(samples[i]);
+        if (i + 1 >= window) treeSum += tree.median();
+    }
+    auto t3 = Clock::now();
+
+    auto nsPer = [&](Clock::duration d) { return (double)chrono::duration_cast<chrono::nanoseconds>(d).count() / (double)samples.size(); };
+    cout << name << ": window=" << window << " samples=" << samples.size() << "\n"
+         << "  two-heap : " << nsPer(t1 - t0) << " ns/sample, peak entries " << heapPeak << "\n"
+         << "  os-treap : " << nsPer(t3 - t2) << " ns/sample, peak entries " << tree.footprint()
+         << ", p99 " << tree.percentile(0.99) << "\n"
+         << "  medians " << (heapSum == treeSum ? "agree" : "DIFFER") << "\n";
+}
+
 int main()
 {
-    
-    cout << "Ibrahim \n";
+    const size_t window = 1000000;
+    const size_t count = 3 * window;
+
+    // Latency-like: log-normal around ~1ms, in microseconds.
+    mt19937_64 rng(42);
+    lognormal_distribution<double> latency(7.0, 0.6);
+    vector<long long> samples(count);
+    for (auto& s : samples) s = (long long)latency(rng);
+    bench("lognormal latency", samples, window);
+
+    // Rising values: every evicted sample is the window minimum, buried under `low`'s top.
+    for (size_t i = 0; i < count; ++i) samples[i] = (long long)i;
+    bench("rising", samples, window);
+
     return 0;
-}
\ No newline at end of file
+}
@@ -35,7 +35,7 @@ public:
         {
            int dist = p[0] * p[0] + p[1] * p[1];
            maxHeap.push({dist,p});
-           if (maxHeap.size() > k)
+           if (maxHeap.size() > static_cast<size_t>(k))
            {
                 maxHeap.pop();
            }
@@ -13,7 +13,7 @@ public:
     {
 
         pq.push(newNumber);
-        if (pq.size() > k_)
+        if (pq.size() > static_cast<size_t>(k_))
         {
             pq.pop();
         }
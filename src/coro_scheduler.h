@@ -0,0 +1,271 @@
+// coro_scheduler.h
+// C++20 (coroutines), STL only; empty when built as C++17
+//
+// Thread-free consumers for the mutex-based schedulers (scheduler_core.h): thousands of
+// coroutines can wait on `co_await sched.next(executor)` while a few executor threads run
+// whichever of them has work.
+//
+//   Detached consumer(FairTaskScheduler<>& sched, CoroExecutor& ex)
+//   {
+//       while (auto t = co_await sched.next(ex)) handle(*t);
+//   }
+//   ...
+//   CoroExecutor ex(2);
+//   ex.drive(sched);                        // delayed tasks, retries and rate limits
+//   for (...) ex.spawn(consumer(sched, ex));
+//   ...
+//   sched.shutdown();                       // every parked consumer gets nullopt
+//   ex.join();                              // waits for the spawned coroutines to return
+//
+// - A consumer with nothing to do costs one TaskWaiter (inside its coroutine frame) on the
+//   scheduler's waiter list: no thread, no condition variable.
+// - submit() pops the task for the oldest parked waiter under the lock it already holds
+//   and posts that coroutine to its executor: a queue push and one notify, instead of a
+//   condition-variable wake-up that then has to retake the scheduler lock.
+// - Delayed tasks and tenant refills have no submit to carry them, so drive() has an idle
+//   executor thread call pollAsync() at the scheduler's next deadline. The scheduler pokes
+//   the executor through its wake hook when a new, earlier deadline appears.
+// - Blocking getNext() is unchanged; both kinds of consumer can share a scheduler. Parked
+//   coroutines are served first, and only leftover work wakes blocked threads.
+// - Tasks are handed over just as getNext() does it: retries, complete()/fail() and metrics
+//   behave the same.
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "scheduler_core.h"
+#include "task.h"
+
+template <typename Source, typename Executor>
+class NextAwaiter : private TaskWaiter
+{
+public:
+    NextAwaiter(Source& source, Executor& ex) : source_(source), ex_(ex) { resume = &NextAwaiter::post; }
+
+    bool await_ready() const noexcept { return false; }
+
+    // Tries to take a task right away; suspends only if the waiter was parked. Once parked,
+    // a submit on another thread may resume the coroutine before this returns, so nothing
+    // here touches the awaiter after getNextAsync().
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        handle_ = h;
+        return !source_.getNextAsync(*this);
+    }
+
+    std::optional<Task> await_resume() { return std::move(task); }
+
+private:
+    static void post(TaskWaiter* w)
+    {
+        NextAwaiter* self = static_cast<NextAwaiter*>(w);
+        self->ex_.post(self->handle_);
+    }
+
+    Source& source_;
+    Executor& ex_;
+    std::coroutine_handle<> handle_;
+};
+
+class CoroExecutor;
+
+// Fire-and-forget coroutine for CoroExecutor::spawn(): starts suspended, frees itself when
+// it returns. An exception escaping it terminates the process.
+class Detached
+{
+public:
+    struct promise_type
+    {
+        CoroExecutor* ex = nullptr;
+
+        ~promise_type();
+
+        Detached get_return_object() { return Detached(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    Detached(Detached&& other) noexcept : h_(std::exchange(other.h_, {})) {}
+    Detached& operator=(Detached&&) = delete;
+
+    // Never spawned: never ran, so just free the frame.
+    ~Detached()
+    {
+        if (h_) h_.destroy();
+    }
+
+private:
+    friend class CoroExecutor;
+
+    explicit Detached(std::coroutine_handle<promise_type> h) : h_(h) {}
+
+    std::coroutine_handle<promise_type> h_;
+};
+
+// A few threads resuming posted coroutines in FIFO order, plus the pollers of the schedulers
+// it drives. Coroutines resumed here must not block for long: that stalls a whole thread.
+class CoroExecutor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CoroExecutor(std::size_t threads = 1)
+    {
+        threads_.reserve(threads ? threads : 1);
+        for (std::size_t i = 0; i < (threads ? threads : 1); ++i)
+            threads_.emplace_back([this] { run(); });
+    }
+
+    ~CoroExecutor() { join(); }
+
+    CoroExecutor(const CoroExecutor&) = delete;
+    CoroExecutor& operator=(const CoroExecutor&) = delete;
+
+    void post(std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            ready_.push_back(h);
+        }
+        cv_.notify_one();
+    }
+
+    // Runs `d` on this executor; it counts as live until it returns.
+    void spawn(Detached d)
+    {
+        d.h_.promise().ex = this;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            ++live_;
+        }
+        post(std::exchange(d.h_, {}));
+    }
+
+    // Releases `sched`'s delayed tasks and tenant refills to its parked coroutines. Call
+    // before any coroutine awaits sched.next(); `sched` must outlive this executor.
+    template <typename Sched>
+    void drive(Sched& sched)
+    {
+        sched.setAsyncWakeHook([this] { wake(); });
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            pollers_.push_back([&sched] { return sched.pollAsync(); });
+            pollNow_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    // Waits until every spawned coroutine has returned, then stops the threads. Coroutines
+    // parked in a scheduler only return once it serves them or shuts down.
+    void join()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& t : threads_)
+            if (t.joinable()) t.join();
+    }
+
+private:
+    friend struct Detached::promise_type;
+
+    void finished()
+    {
+        bool last = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            last = --live_ == 0 && stopping_;
+        }
+        if (last) cv_.notify_all();
+    }
+
+    // A driven scheduler has a deadline earlier than the one being waited for.
+    void wake()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            pollNow_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        for (;;)
+        {
+            if (!ready_.empty())
+            {
+                std::coroutine_handle<> h = ready_.front();
+                ready_.pop_front();
+                lock.unlock();
+                h.resume();
+                lock.lock();
+                continue;
+            }
+            if (stopping_ && live_ == 0) return;
+
+            // One thread polls at a time; the others keep resuming coroutines meanwhile.
+            if (!polling_ && !pollers_.empty() && (pollNow_ || (pollAt_ && *pollAt_ <= Clock::now())))
+            {
+                polling_ = true;
+                pollNow_ = false;
+                std::vector<Poller> pollers = pollers_; // drive() may append meanwhile
+                lock.unlock();
+                std::optional<Clock::time_point> next;
+                for (auto& poll : pollers)
+                {
+                    auto at = poll();
+                    if (at && (!next || *at < *next)) next = at;
+                }
+                lock.lock();
+                polling_ = false;
+                pollAt_ = next;
+                continue;
+            }
+
+            if (pollAt_ && !polling_) cv_.wait_until(lock, *pollAt_);
+            else cv_.wait(lock);
+        }
+    }
+
+    std::mutex mtx_; // never held while resuming a coroutine or polling a scheduler
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::size_t live_ = 0; // spawned coroutines that have not returned
+    bool stopping_ = false;
+
+    using Poller = std::function<std::optional<Clock::time_point>()>;
+
+    std::vector<Poller> pollers_;
+    std::optional<Clock::time_point> pollAt_; // earliest deadline of the driven schedulers
+    bool pollNow_ = false;
+    bool polling_ = false;
+
+    std::vector<std::thread> threads_;
+};
+
+inline Detached::promise_type::~promise_type()
+{
+    if (ex) ex->finished();
+}
+
+#endif // __cpp_impl_coroutine
@@ -0,0 +1,292 @@
+// dependency_graph.h
+// C++17, STL only
+//
+// Task dependencies for the mutex-based schedulers (scheduler_core.h): a task submitted
+// with deps waits here, blocked, until every one of them has completed, then the scheduler
+// queues it like a fresh submit.
+//
+// - Graph nodes are task IDs from submit-with-deps until the task completes (or is
+//   dropped). A dep that is not in the graph counts as already done, so a task can only
+//   wait on tasks submitted before it (or in the same batch).
+// - Each node keeps its in-degree (deps not yet done) and a pooled list of its dependents.
+//   complete() walks that list once and decrements; a dependent whose count reaches zero
+//   is released on the spot. Nothing is ever rescanned: O(edges) over the whole graph.
+// - Cycles: a single add() can't close one (its deps all exist already; re-adding a live
+//   ID is refused). A batch may reference its own members in any order, so checkBatch()
+//   runs Kahn's algorithm over the batch first and the scheduler refuses it whole if a
+//   cycle remains.
+// - Not thread-safe: the scheduler calls it under its lock.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "id_interner.h"
+#include "task.h"
+
+// A task and the IDs of the tasks it waits for.
+struct DependentTask
+{
+    Task task;
+    std::vector<std::string> deps;
+};
+
+class DependencyGraph
+{
+public:
+    using Handle = TaskIdTable::Handle; // the scheduler's handle of a blocked task
+
+    bool contains(const std::string& id) const { return index_.count(id) != 0; }
+
+    // True while `id` waits for deps (submitted, not released yet).
+    bool isBlocked(const std::string& id) const
+    {
+        auto it = index_.find(id);
+        return it != index_.end() && nodes_[it->second].pending > 0;
+    }
+
+    // add() precondition: `id` is not in the graph and not among its own deps.
+    bool accepts(const std::string& id, const std::vector<std::string>& deps) const
+    {
+        if (contains(id)) return false;
+        for (const std::string& d : deps)
+            if (d == id) return false;
+        return true;
+    }
+
+    // Blocked tasks (submitted, not yet released).
+    std::size_t blocked() const noexcept { return blocked_; }
+
+    // Graph nodes: blocked tasks plus released ones not yet completed.
+    std::size_t size() const noexcept { return index_.size(); }
+
+    // Adds `id` (scheduler handle `h`) waiting on `deps`; see accepts(). Returns true if
+    // every dep is done already (queue the task now), false if it is blocked until
+    // complete() releases it.
+    bool add(const std::string& id, const std::vector<std::string>& deps, Handle h)
+    {
+        const std::uint32_t n = allocNode(h);
+        auto it = index_.emplace(id, n).first;
+        nodes_[n].id = &it->first;
+        for (const std::string& d : deps)
+        {
+            auto dep = index_.find(d);
+            if (dep == index_.end()) continue;
+            linkEdge(dep->second, n);
+            ++nodes_[n].pending;
+        }
+
+        if (nodes_[n].pending == 0) return true;
+        ++blocked_;
+        return false;
+    }
+
+    // Checks a batch before any of it is admitted: IDs must be new (to the graph and to
+    // the batch) and the deps among the batch acyclic. On success `order` holds the batch
+    // positions in topological order, so add() them in that order. O(tasks + deps).
+    bool checkBatch(const std::vector<DependentTask>& batch, std::vector<std::size_t>& order) const
+    {
+        const std::size_t n = batch.size();
+        std::unordered_map<std::string_view, std::uint32_t> pos; // views into `batch`
+        pos.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const std::string& id = batch[i].task.task_id;
+            if (contains(id) || !pos.emplace(id, static_cast<std::uint32_t>(i)).second) return false;
+        }
+
+        // In-batch edges only (deps outside the batch can't cycle back), as a CSR adjacency:
+        // edge (dep -> i) for every dep that is a batch member.
+        std::vector<std::uint32_t> from, indegree(n, 0), start(n + 1, 0);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            for (const std::string& d : batch[i].deps)
+            {
+                auto it = pos.find(d);
+                if (it == pos.end()) continue;
+                if (it->second == i) return false;
+                from.push_back(it->second);
+                ++start[it->second + 1];
+                ++indegree[i];
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i) start[i + 1] += start[i];
+
+        std::vector<std::uint32_t> dependents(from.size()), fill(start.begin(), start.end() - 1);
+        for (std::size_t i = 0, e = 0; i < n; ++i)
+        {
+            for (std::uint32_t k = 0; k < indegree[i]; ++k) dependents[fill[from[e++]]++] = static_cast<std::uint32_t>(i);
+        }
+
+        // Kahn's algorithm: whatever never reaches in-degree zero is on (or behind) a cycle.
+        order.clear();
+        order.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            if (indegree[i] == 0) order.push_back(i);
+        for (std::size_t k = 0; k < order.size(); ++k)
+        {
+            for (std::uint32_t e = start[order[k]]; e < start[order[k] + 1]; ++e)
+                if (--indegree[dependents[e]] == 0) order.push_back(dependents[e]);
+        }
+        return order.size() == n;
+    }
+
+    // `id` finished: every dependent that was waiting only on it is passed to
+    // ready(handle), then `id` leaves the graph. Returns false if `id` is not in the graph
+    // or still blocked (it can't have run).
+    template <typename Ready>
+    bool complete(const std::string& id, Ready&& ready)
+    {
+        auto it = index_.find(id);
+        if (it == index_.end() || nodes_[it->second].pending > 0) return false;
+
+        const std::uint32_t n = it->second;
+        index_.erase(it);
+        for (std::uint32_t e = nodes_[n].firstEdge; e != npos; e = edges_[e].next)
+        {
+            const std::uint32_t d = edges_[e].to;
+            if (--nodes_[d].pending > 0) continue;
+            if (nodes_[d].state == State::Dropped)
+            {
+                freeNodes_.push_back(d); // its last incoming edge is gone
+                continue;
+            }
+            --blocked_;
+            ready(nodes_[d].handle);
+        }
+        releaseEdges(n);
+        freeNodes_.push_back(n);
+        return true;
+    }
+
+    // `id` will never complete (canceled, dead-lettered): it leaves the graph with every
+    // task that transitively depends on it. dropped(handle) is called for each of those
+    // dependents (all still blocked, since they wait on `id`) so the scheduler can free
+    // the stored task. Returns false if `id` is not in the graph.
+    template <typename Dropped>
+    bool drop(const std::string& id, Dropped&& dropped)
+    {
+        auto it = index_.find(id);
+        if (it == index_.end()) return false;
+
+        const std::uint32_t root = it->second;
+        index_.erase(it);
+        if (nodes_[root].pending > 0) --blocked_;
+        nodes_[root].state = State::Dropping;
+
+        std::vector<std::uint32_t> stack{root};
+        while (!stack.empty())
+        {
+            const std::uint32_t n = stack.back();
+            stack.pop_back();
+            for (std::uint32_t e = nodes_[n].firstEdge; e != npos; e = edges_[e].next)
+            {
+                const std::uint32_t d = edges_[e].to;
+                --nodes_[d].pending;
+                if (nodes_[d].state == State::Live)
+                {
+                    nodes_[d].state = State::Dropping;
+                    --blocked_;
+                    index_.erase(index_.find(*nodes_[d].id));
+                    dropped(nodes_[d].handle);
+                    stack.push_back(d);
+                }
+                else if (nodes_[d].state == State::Dropped && nodes_[d].pending == 0)
+                {
+                    freeNodes_.push_back(d);
+                }
+            }
+            releaseEdges(n);
+            // A node other live deps still point at stays as a tombstone until they let go.
+            nodes_[n].state = State::Dropped;
+            if (nodes_[n].pending == 0) freeNodes_.push_back(n);
+        }
+        return true;
+    }
+
+private:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    enum class State : std::uint8_t
+    {
+        Live,
+        Dropping, // dropped, its dependents not yet visited
+        Dropped,  // tombstone: freed once `pending` (incoming edges) reaches zero
+    };
+
+    struct Node
+    {
+        Handle handle = 0;
+        std::uint32_t pending = 0;       // incoming edges: deps not yet completed
+        std::uint32_t firstEdge = npos;  // dependents, newest first
+        State state = State::Live;
+        const std::string* id = nullptr; // key in index_ while Live (node-based map: stable)
+    };
+
+    struct Edge
+    {
+        std::uint32_t to;   // the dependent node
+        std::uint32_t next; // next edge of the same dep, or the free list
+    };
+
+    std::uint32_t allocNode(Handle h)
+    {
+        std::uint32_t n;
+        if (!freeNodes_.empty())
+        {
+            n = freeNodes_.back();
+            freeNodes_.pop_back();
+        }
+        else
+        {
+            n = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        nodes_[n] = Node{};
+        nodes_[n].handle = h;
+        return n;
+    }
+
+    void releaseEdges(std::uint32_t n)
+    {
+        std::uint32_t e = nodes_[n].firstEdge;
+        while (e != npos)
+        {
+            const std::uint32_t next = edges_[e].next;
+            edges_[e].next = freeEdge_;
+            freeEdge_ = e;
+            e = next;
+        }
+        nodes_[n].firstEdge = npos;
+    }
+
+    void linkEdge(std::uint32_t from, std::uint32_t to)
+    {
+        std::uint32_t e;
+        if (freeEdge_ != npos)
+        {
+            e = freeEdge_;
+            freeEdge_ = edges_[e].next;
+        }
+        else
+        {
+            e = static_cast<std::uint32_t>(edges_.size());
+            edges_.emplace_back();
+        }
+        edges_[e] = Edge{to, nodes_[from].firstEdge};
+        nodes_[from].firstEdge = e;
+    }
+
+    SlabHashMap<std::string, std::uint32_t> index_; // task ID -> node
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> freeNodes_;
+    std::vector<Edge> edges_; // pooled adjacency lists
+    std::uint32_t freeEdge_ = npos;
+    std::size_t blocked_ = 0;
+};
@@ -5,66 +5,27 @@
 #include <functional>
 #include <utility>
 
+#include "sorted_set_ops.h"
+
 
 using namespace std;
+// Linear, galloping or binary-probe by size ratio (setops::chooseStrategy). Lookups pair
+// repeats up themselves, so only the linear path checks for sets (an O(n + m) scan, cheap
+// next to a linear pass): posting lists get the SIMD kernels, lists with repeats keep the
+// pairwise (multiset) matching.
 vector<int> intersectStored(const vector<int> &a, const vector<int> &b)
 {
-
-    vector<int> result;
-    size_t i = 0, j = 0;
-    while (i < a.size() && j < b.size())
-    {
-        if (a[i] == b[j])
-        {
-            result.push_back(a[i]);
-            i++;
-            j++;
-        }
-        else if (a[i] < b[j])
-        {
-            i++;
-        }
-        else
-        {
-            j++;
-        }
-    }
-
-    return result;
+    const setops::Strategy strategy = setops::chooseStrategy(a, b);
+    if (strategy != setops::Strategy::Linear)
+        return setops::intersect(a, b, strategy);
+    if (setops::isStrictlyIncreasing(a) && setops::isStrictlyIncreasing(b))
+        return setops::intersectSets(a, b, strategy);
+    return setops::intersect(a, b, strategy);
 }
 
 vector<int> mergedSorted(const vector<int> &a, const vector<int> &b)
 {
-
-    vector<int> out;
-    out.reserve(a.size() + b.size());
-    size_t i = 0, j = 0;
-    while (i < a.size() && j < b.size())
-    {
-        if (a[i] <= b[j])
-        {
-            out.push_back(a[i]);
-            i++;
-        }
-        else
-        {
-            out.push_back(b[j]);
-            j++;
-        }
-    }
-    while (i < a.size())
-    {
-        out.push_back(a[i]);
-        i++;
-    }
-
-    while (j < b.size())
-    {
-        out.push_back(b[j]);
-        j++;
-    }
-
-    return out;
+    return setops::merge(a, b);
 }
 
 void removeDuplicated(vector<int> &a)
@@ -94,7 +55,7 @@ vector<int> topK(const vector<int> &nums, int k)
     for (int x : nums)
     {
         pq.push(x);
-        if (pq.size() > k)
+        if (pq.size() > static_cast<size_t>(k))
         {
             pq.pop();
         }
@@ -124,7 +85,7 @@ vector<int> topKFrequent(const vector<int>& nums, int k){
         for (auto& [value,count] : req)
         {
            pq.push({count, value});
-           if (pq.size() > k)
+           if (pq.size() > static_cast<size_t>(k))
            {
                 pq.pop();
            }
@@ -156,7 +117,7 @@ vector<int> mergedKSorted(const vector<vector<int>>& lists){
 
     priority_queue<Node, vector<Node>, greater<Node>> pq;
 
-    for (int i = 0; i < lists.size(); i++)
+    for (int i = 0; i < static_cast<int>(lists.size()); i++)
     {
        if (!lists[i].empty())
        {
@@ -175,7 +136,7 @@ vector<int> mergedKSorted(const vector<vector<int>>& lists){
        pq.pop();
        result.push_back(curr.value);
        int nextInx = curr.elemIndx+1;
-       if (nextInx < lists[curr.listIndex].size())
+       if (static_cast<size_t>(nextInx) < lists[curr.listIndex].size())
        {
             pq.push({
                 lists[curr.listIndex][nextInx],
@@ -189,6 +150,14 @@ vector<int> mergedKSorted(const vector<vector<int>>& lists){
 }
 
 
+// Values in every list; each list strictly increasing. Smallest list first, stops once empty.
+vector<int> intersectKSorted(const vector<vector<int>>& lists){
+
+    vector<setops::IntSpan> spans(lists.begin(), lists.end());
+    return setops::intersectMany(spans);
+}
+
+
 int main()
 {
 
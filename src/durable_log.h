@@ -0,0 +1,35 @@
+// durable_log.h
+// C++17, STL only
+//
+// DurableLog: what a scheduler needs from a write-ahead log. scheduler_core.h only sees
+// this interface, so the schedulers stay STL only; the implementation, TaskLog, lives in
+// task_log.h (POSIX). Include task_log.h where a log is opened and passed to attachLog().
+// Calls are virtual, but only made with a log attached, where an fsync dwarfs them.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "task.h"
+
+class DurableLog
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~DurableLog() = default;
+
+    // Appends return a log sequence number for waitDurable(). Task IDs must be unique
+    // among live tasks; a Submit for a live ID replaces it.
+    virtual std::uint64_t logSubmit(const Task& t, std::optional<Clock::time_point> due = std::nullopt) = 0;
+    virtual std::uint64_t logSubmitBatch(const Task* tasks, std::size_t count) = 0;
+    virtual std::uint64_t logCancel(const std::string& taskId) = 0;
+    virtual std::uint64_t logComplete(const std::string& taskId) = 0;
+
+    // Blocks until record `lsn` is on disk. False once the log has failed to persist it.
+    virtual bool waitDurable(std::uint64_t lsn) = 0;
+};
@@ -1,152 +1,43 @@
 // fair_scheduler.cpp
-// C++17
-// Per-tenant Round-Robin scheduler
-// Same API as fifo_scheduler.cpp
+// C++17, STL only
+// Demo for FairTaskScheduler (fair_scheduler.h): a few workers drain a small per-tenant fair workload.
+// Built as C++20, the workers are coroutines sharing one executor thread (coro_scheduler.h).
 
-#include <string>
-#include <optional>
+#include <chrono>
 #include <cstdint>
-#include <vector>
 #include <iostream>
-#include <unordered_map>
-#include <unordered_set>
-#include <mutex>
-#include <condition_variable>
+#include <string>
 #include <thread>
-#include <deque>
-#include <chrono>
+#include <vector>
 
-struct Task
-{
-    std::string task_id;
-    std::string tenant_id;
-    int priority = 0; // not used for fairness here
-    std::uint64_t ts = 0;
-};
+#include "coro_scheduler.h"
+#include "fair_scheduler.h"
 
-class FairTaskScheduler
+#if defined(__cpp_impl_coroutine)
+Detached worker(FairTaskScheduler<> &sched, CoroExecutor &ex, int i)
 {
-public:
-    bool submit(Task t)
-    {
-        {
-            std::lock_guard<std::mutex> lock(mtx_);
-            if (shutdown_)
-                return false;
-
-            canceled_.erase(t.task_id);
-
-            auto &tenantQueue = perTenant_[t.tenant_id];
-            bool wasEmpty = tenantQueue.empty();
-            tenantQueue.push_back(std::move(t));
-
-            if (wasEmpty)
-                activeRing_.push_back(t.tenant_id);
-        }
-        cv_.notify_one();
-        return true;
-    }
-
-    bool cancel(const std::string &taskId)
-    {
-        std::lock_guard<std::mutex> lock(mtx_);
-        return canceled_.insert(taskId).second;
-    }
-
-    std::optional<Task> tryGetNext()
-    {
-        std::lock_guard<std::mutex> lock(mtx_);
-        if (shutdown_)
-            return std::nullopt;
-        return popOneUnlocked();
-    }
-
-    std::optional<Task> getNext()
-    {
-        std::unique_lock<std::mutex> lock(mtx_);
-
-        for (;;)
-        {
-            cv_.wait(lock, [&]
-                     { return shutdown_ || !activeRing_.empty(); });
-            if (shutdown_)
-                return std::nullopt;
-
-            if (auto t = popOneUnlocked())
-                return t;
-        }
-    }
-
-    void shutdown()
-    {
-        {
-            std::lock_guard<std::mutex> lock(mtx_);
-            shutdown_ = true;
-        }
-        cv_.notify_all();
-    }
-
-    bool empty() const
+    while (auto t = co_await sched.next(ex))
     {
-        std::lock_guard<std::mutex> lock(mtx_);
-        return activeRing_.empty();
-    }
-
-private:
-    std::optional<Task> popOneUnlocked()
-    {
-        while (!activeRing_.empty())
-        {
-            std::string tenant = std::move(activeRing_.front());
-            activeRing_.pop_front();
-
-            auto it = perTenant_.find(tenant);
-            if (it == perTenant_.end() || it->second.empty())
-                continue;
-
-            auto &tenantQueue = it->second;
-
-            while (!tenantQueue.empty())
-            {
-                Task t = std::move(tenantQueue.front());
-                tenantQueue.pop_front();
-
-                auto cancelIt = canceled_.find(t.task_id);
-                if (cancelIt != canceled_.end())
-                {
-                    canceled_.erase(cancelIt);
-                    continue;
-                }
-
-                if (!tenantQueue.empty())
-                    activeRing_.push_back(tenant);
-                else
-                    perTenant_.erase(it);
-
-                return t;
-            }
-
-            perTenant_.erase(it);
-        }
-
-        return std::nullopt;
+        std::cout << "[Worker=" << i << "] "
+                  << "tenant=" << t->tenant_id
+                  << " task=" << t->task_id
+                  << "\n";
     }
-
-private:
-    std::unordered_map<std::string, std::deque<Task>> perTenant_;
-    std::deque<std::string> activeRing_;
-    std::unordered_set<std::string> canceled_;
-
-    mutable std::mutex mtx_;
-    std::condition_variable cv_;
-    bool shutdown_ = false;
-};
+    std::cout << "[Worker=" << i << "] exiting\n";
+}
+#endif
 
 int main()
 {
     FairTaskScheduler sched;
 
     const int workerCount = 3;
+#if defined(__cpp_impl_coroutine)
+    CoroExecutor executor(1);
+    executor.drive(sched);
+    for (int i = 0; i < workerCount; ++i)
+        executor.spawn(worker(sched, executor, i));
+#else
     std::vector<std::thread> workers;
     workers.reserve(workerCount);
 
@@ -164,6 +55,7 @@ int main()
             }
             std::cout << "[Worker=" << i << "] exiting\n"; });
     }
+#endif
 
     // Tenant A floods
     for (int i = 0; i < 10; ++i)
@@ -182,8 +74,12 @@ int main()
     std::this_thread::sleep_for(std::chrono::seconds(2));
     sched.shutdown();
 
+#if defined(__cpp_impl_coroutine)
+    executor.join();
+#else
     for (auto &th : workers)
         th.join();
+#endif
 
     return 0;
 }
@@ -0,0 +1,138 @@
+// fair_scheduler.h
+// C++17
+// Per-tenant Round-Robin scheduler
+// Same API as fifo_scheduler.h
+//
+// FairTaskScheduler<WaitPolicy> is Scheduler<FairQueue, WaitPolicy> (scheduler_core.h;
+// WaitPolicy from wait_policy.h, CondVarWait by default) plus tenant weights: the
+// core brings the lock, blocking, cancel, delays, retries, rate limits and metrics;
+// FairQueue orders tasks with one TenantRing (tenant_ring.h).
+//
+// Tenant and task IDs are interned to dense 32-bit handles at submit time
+// (see id_interner.h), so the pop path never hashes or copies strings.
+// Lanes are intrusive lists over pooled nodes (intrusive_task_list.h), so
+// cancel() unlinks the task immediately: size() is exact and nothing dead is queued.
+//
+// Modes (FairOptions::mode):
+// - RoundRobin        : one task per tenant turn, regardless of weight or cost.
+// - DeficitRoundRobin : each turn a tenant earns quantum * weight credits and runs tasks
+//                       while its credit covers Task::cost. O(1) amortized per pop as long
+//                       as quantum * weight >= typical cost. Weights can be changed at
+//                       runtime (setTenantWeight) and apply from the tenant's next turn.
+//
+// Delayed tasks: submitAt/submitAfter park the task in a hierarchical timing wheel
+// (timing_wheel.h). Due tasks join the back of their tenant lane; getNext() sleeps
+// until the nearest deadline instead of polling. cancel() works on delayed tasks too.
+//
+// Retries (retry_policy.h): with setRetryPolicy(), workers report complete(taskId) or
+// fail(taskId). A failed task comes back through submitAfter() with a jittered backoff,
+// so it re-enters the back of its own tenant lane; after maxAttempts runs it goes to
+// the dead-letter queue instead.
+//
+// Rate limits (rate_limiter.h): setTenantRateLimit() gives a tenant a token bucket charged
+// Task::cost per dispatch. A tenant that can't pay for its head task is parked off
+// the ring in a timing wheel until its refill time, so skipping it costs nothing;
+// getNext() sleeps until the earliest refill, and other tenants' work is never held back.
+//
+// Metrics (scheduler_metrics.h): per-thread counters and wait histograms, read with
+// metricsSnapshot() or metricsText() (Prometheus text format, with per-tenant depth).
+//
+// Durability (task_log.h): attachLog() replays a write-ahead log into the tenant lanes,
+// then logs submits, cancels and completions, so a restart keeps the backlog.
+//
+// Dependencies (dependency_graph.h): submit(task, deps) queues a task into its tenant lane
+// once its deps have completed; submitGraph() takes a whole job graph and refuses cycles.
+//
+// Async consumers (coro_scheduler.h, C++20): `co_await sched.next(executor)` waits without
+// a thread; submits hand tasks straight to parked coroutines.
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#include "id_interner.h"
+#include "scheduler_core.h"
+#include "task.h"
+#include "tenant_ring.h"
+
+struct FairOptions
+{
+    FairMode mode = FairMode::RoundRobin;
+    std::uint32_t quantum = 1; // DRR credits per turn for a weight-1 tenant
+};
+
+// QueuePolicy for Scheduler: one tenant ring. Tenants have no bands (depth band = -1).
+class FairQueue
+{
+public:
+    using Nodes = TaskNodes<Task>;
+
+    static constexpr bool kTenants = true;
+    static constexpr const char *kName = "fair";
+
+    FairQueue() = default;
+    explicit FairQueue(FairOptions opts) : ring_(opts.mode, opts.quantum) {}
+
+    void normalize(Task &) const {}
+
+    void push(Nodes &nodes, TaskIdTable::Handle handle) { ring_.push(nodes, handle); }
+    void unlink(Nodes &nodes, TaskIdTable::Handle handle) { ring_.unlink(nodes, handle); }
+
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> pop(Nodes &nodes, Admit &admit, SchedulerMetrics &metrics)
+    {
+        return ring_.popOne(
+            nodes, [&](IdInterner::Handle tenant, TaskIdTable::Handle handle)
+            { return admit(0, tenant, handle); },
+            metrics);
+    }
+
+    void unpark(std::size_t, IdInterner::Handle tenant) { ring_.unpark(tenant); }
+
+    bool empty() const noexcept { return ring_.empty(); }
+    std::size_t size() const noexcept { return ring_.size(); }
+    bool runnable() const noexcept { return ring_.runnable(); }
+
+    template <typename Fn>
+    void forEachLane(Fn &&fn) const
+    {
+        ring_.forEachLane([&](IdInterner::Handle tenant, std::size_t n)
+                          { fn(-1, tenant, n); });
+    }
+
+    void setWeight(IdInterner::Handle tenant, std::uint32_t weight) { ring_.setWeight(tenant, weight); }
+
+private:
+    TenantRing ring_;
+};
+
+template <typename WaitPolicy = CondVarWait>
+class FairTaskScheduler : public Scheduler<FairQueue, WaitPolicy>
+{
+    using Base = Scheduler<FairQueue, WaitPolicy>;
+
+public:
+    FairTaskScheduler() = default;
+    explicit FairTaskScheduler(FairOptions opts) : Base(opts) {}
+
+    // DRR weight for a tenant (default 1, clamped to >= 1). Safe while tasks are queued.
+    void setTenantWeight(const std::string &tenantId, std::uint32_t weight)
+    {
+        auto lock = metrics::lockTimed(this->mtx_, this->metrics_);
+        this->queue_.setWeight(this->tenants_.intern(tenantId), weight);
+    }
+
+    // Reporting: queued tasks per tenant (parked tenants included).
+    std::vector<std::pair<std::string, std::size_t>> pendingByTenant() const
+    {
+        auto lock = metrics::lockTimed(this->mtx_, this->metrics_);
+        std::vector<std::pair<std::string, std::size_t>> out;
+        this->queue_.forEachLane([&](int, IdInterner::Handle tenant, std::size_t n)
+                                 { out.emplace_back(this->tenants_.name(tenant), n); });
+        return out;
+    }
+};
@@ -0,0 +1,1190 @@
+// fifo_scheduler.h
+// C++17, STL only
+// FIFO scheduler with the SAME style/API as your TaskScheduler:
+//   submit(Task), cancel(task_id), tryGetNext(), getNext(), shutdown()
+// Notes:
+// - FIFO order by arrival (not by priority).
+// - cancel():
+//     SingleQueue       : eager. The task is unlinked in O(1) from an intrusive list of pooled
+//                         nodes (intrusive_task_list.h); size() is exact, no tombstones.
+//     WorkStealing/Ring : lazy. Task stays queued and is skipped when popped (one-time marker);
+//                         an O(1) unlink would need a global index on these lock-light paths.
+// - getNext() blocks until a task is available or shutdown() is called.
+// - Backend is chosen at construction:
+//     SingleQueue  : Scheduler<FifoQueue> (scheduler_core.h): one mutex + one intrusive list
+//                    (default, simplest to reason about).
+//     WorkStealing : one shard (mutex + deque) per thread, shared round-robin once threads
+//                    outnumber shards; consumers drain their own shard, then steal.
+//                    Per-producer FIFO still holds: a producer always feeds the same shard,
+//                    and both owners and thieves take from the front.
+//     Ring         : bounded lock-free MPMC ring; no allocation after construction.
+//                    submit() blocks while full, trySubmit() fails fast instead.
+//                    Workers spin adaptively before parking on a condition variable.
+// - submitAt/submitAfter hold a task in a hierarchical timing wheel (timing_wheel.h):
+//     SingleQueue       : the wheel lives under the core's lock; getNext() sleeps until the nearest
+//                         deadline and releases due tasks itself. cancel() covers delayed tasks.
+//     WorkStealing/Ring : one background feeder thread owns the wheel and pushes due tasks
+//                         into the backend, so the lock-light pop paths stay timer-free.
+// - Retries (retry_policy.h): workers report complete(taskId) / fail(taskId); a failed task
+//   is resubmitted with a jittered backoff, and dead-lettered after maxAttempts runs.
+// - Metrics (scheduler_metrics.h): per-thread counters and wait histograms on every backend
+//   (lazy cancel markers skipped, time parked), read with metricsSnapshot() / metricsText().
+// - Durability (task_log.h): SingleQueue only. attachLog() replays a write-ahead log and
+//   then logs submits, cancels and completions; the lock-free backends don't log.
+// - Dependencies (dependency_graph.h): SingleQueue only. submit(task, deps) and
+//   submitGraph() hold a task until its deps have completed.
+// - Async consumers (coro_scheduler.h, C++20): SingleQueue only. `co_await next(ex)`
+//   parks a coroutine instead of a thread; on the lock-free backends it yields nullopt at once.
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <cstdint>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <functional>
+
+#include "id_interner.h"
+#include "intrusive_task_list.h"
+#include "retry_policy.h"
+#include "scheduler_core.h"
+#include "scheduler_metrics.h"
+#include "slab_allocator.h"
+#include "task.h"
+#include "timing_wheel.h"
+#include "wait_policy.h"
+
+enum class FifoBackend
+{
+    SingleQueue,
+    WorkStealing,
+    Ring,
+};
+
+struct FifoOptions
+{
+    FifoBackend backend = FifoBackend::SingleQueue;
+    std::size_t shards = 0;           // WorkStealing only; 0 = one per hardware thread
+    std::size_t ringCapacity = 4096;  // Ring only; rounded up to a power of two
+};
+
+// --------- Wait helpers (internal) ---------
+// Condition-variable parking that only takes the lock when someone is actually asleep.
+//
+// Dekker-style handshake: the sleeper publishes sleepers_ and then reads the queue state
+// (the predicate); a waker publishes queue state (possibly with relaxed or release
+// operations, e.g. MpmcRing's cursor CAS) and then reads sleepers_. A seq_cst fence on
+// both sides orders each store before the following load, so at least one of them sees the
+// other: either the sleeper finds the work or the waker finds the sleeper. Without the
+// fences a weakly ordered CPU (aarch64, POWER) may let both loads see stale values.
+class Parker
+{
+public:
+    template <typename Pred>
+    void park(Pred ready)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv_.wait(lock, ready);
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void wakeOne()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst); // caller's publish before the read
+        if (sleepers_.load(std::memory_order_seq_cst) == 0) return;
+        {
+            // Pairs with the predicate check in park(), so the wake-up can't be lost.
+            std::lock_guard<std::mutex> lock(mtx_);
+        }
+        cv_.notify_one();
+    }
+
+    // Wakes at most `n` sleepers; waking more would just have them find nothing.
+    void wake(std::size_t n)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int sleeping = sleepers_.load(std::memory_order_seq_cst);
+        if (sleeping == 0 || n == 0) return;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+        }
+        if (n >= static_cast<std::size_t>(sleeping)) cv_.notify_all();
+        else while (n--) cv_.notify_one();
+    }
+
+    // Runs `update` under the park lock so waiters observe it atomically, then wakes everyone.
+    template <typename Update>
+    void wakeAll(Update update)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            update();
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::atomic<int> sleepers_{0};
+};
+
+// --------- Work-stealing backend (internal) ---------
+// Every thread gets a home shard on first contact with the scheduler (round-robin), and
+// keeps it: producers, consumers and threads doing both submit into their home shard, so
+// producers spread over the shards instead of meeting on one lock, and a producer never
+// splits its tasks across two queues (FIFO-per-producer holds). Consumers pop their own
+// shard first, then steal from the others, starting next to their own so thieves spread
+// out too.
+class WorkStealingQueues
+{
+public:
+    WorkStealingQueues(std::size_t shards, SchedulerMetrics& metrics) : metrics_(metrics)
+    {
+        if (shards == 0)
+            shards = std::max(1u, std::thread::hardware_concurrency());
+        locals_.reserve(shards);
+        for (std::size_t i = 0; i < shards; ++i)
+            locals_.push_back(std::make_unique<Shard>());
+    }
+
+    bool submit(Task t)
+    {
+        reviveIfCanceled(t.task_id);
+        return enqueue(std::move(t));
+    }
+
+    // submit() without reviving a cancel marker (used for tasks released by timers).
+    bool enqueue(Task t)
+    {
+        if (shutdown_.load(std::memory_order_acquire)) return false;
+
+        // pending_ goes up under the shard lock, before the task is visible: a pop (which
+        // takes that lock) can't decrement it first and wrap it below zero.
+        Shard& target = *locals_[homeShard()];
+        {
+            std::lock_guard<std::mutex> lock(target.mtx);
+            pending_.fetch_add(1, std::memory_order_seq_cst);
+            target.q.push_back(std::move(t));
+            target.count.fetch_add(1, std::memory_order_release);
+        }
+        parker_.wakeOne();
+        return true;
+    }
+
+    std::size_t submitBatch(Task* tasks, std::size_t count)
+    {
+        if (shutdown_.load(std::memory_order_acquire) || count == 0) return 0;
+
+        for (std::size_t i = 0; i < count; ++i)
+            reviveIfCanceled(tasks[i].task_id);
+
+        Shard& target = *locals_[homeShard()];
+        {
+            std::lock_guard<std::mutex> lock(target.mtx);
+            pending_.fetch_add(count, std::memory_order_seq_cst); // before visible, as in enqueue()
+            for (std::size_t i = 0; i < count; ++i)
+                target.q.push_back(std::move(tasks[i]));
+            target.count.fetch_add(count, std::memory_order_release);
+        }
+        parker_.wake(count);
+        return count;
+    }
+
+    bool cancel(const std::string& taskId)
+    {
+        std::lock_guard<std::mutex> lock(cancelMtx_);
+        if (!canceled_.insert(taskId).second) return false;
+        cancelMarkers_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::optional<Task> tryGetNext()
+    {
+        if (shutdown_.load(std::memory_order_acquire)) return std::nullopt;
+        return popAny(homeShard());
+    }
+
+    std::size_t getNextBatch(std::size_t max, std::vector<Task>& out)
+    {
+        const std::size_t home = homeShard();
+        for (;;)
+        {
+            if (shutdown_.load(std::memory_order_acquire) || max == 0) return 0;
+
+            for (int spin = 0, n = spinner_.budget(); spin < n; ++spin)
+            {
+                if (std::size_t got = popMany(home, max, out))
+                {
+                    if (spin > 0) spinner_.onSpinHit();
+                    return got;
+                }
+                if (pending_.load(std::memory_order_acquire) == 0)
+                    std::this_thread::yield();
+            }
+
+            spinner_.onPark();
+            const metrics::Clock::time_point start = metrics::now();
+            parker_.park([&] {
+                return shutdown_.load(std::memory_order_acquire) ||
+                       pending_.load(std::memory_order_seq_cst) > 0;
+            });
+            metrics_.recordSince(metrics::Histogram::WorkWaitNs, start);
+        }
+    }
+
+    std::optional<Task> getNext()
+    {
+        const std::size_t home = homeShard();
+        for (;;)
+        {
+            if (shutdown_.load(std::memory_order_acquire)) return std::nullopt;
+
+            for (int spin = 0, n = spinner_.budget(); spin < n; ++spin)
+            {
+                if (auto t = popAny(home))
+                {
+                    if (spin > 0) spinner_.onSpinHit();
+                    return t;
+                }
+                if (pending_.load(std::memory_order_acquire) == 0)
+                    std::this_thread::yield();
+            }
+
+            spinner_.onPark();
+            const metrics::Clock::time_point start = metrics::now();
+            parker_.park([&] {
+                return shutdown_.load(std::memory_order_acquire) ||
+                       pending_.load(std::memory_order_seq_cst) > 0;
+            });
+            metrics_.recordSince(metrics::Histogram::WorkWaitNs, start);
+        }
+    }
+
+    void shutdown()
+    {
+        parker_.wakeAll([&] { shutdown_.store(true, std::memory_order_release); });
+    }
+
+    bool empty() const
+    {
+        return pending_.load(std::memory_order_acquire) == 0;
+    }
+
+    std::size_t size() const
+    {
+        return pending_.load(std::memory_order_acquire);
+    }
+
+    // Clears a pending cancel marker for an ID being submitted again.
+    void reviveIfCanceled(const std::string& taskId)
+    {
+        if (cancelMarkers_.load(std::memory_order_relaxed) == 0) return;
+        std::lock_guard<std::mutex> lock(cancelMtx_);
+        if (canceled_.erase(taskId))
+            cancelMarkers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(64) Shard
+    {
+        std::mutex mtx;
+        std::deque<Task, SlabAllocator<Task>> q; // deque blocks come from the slab, not malloc
+        std::atomic<std::size_t> count{0}; // lets pollers skip empty shards without locking
+    };
+
+    // Homes a thread remembers, most recently used first. A thread alternating between more
+    // schedulers than this gets a new home in the evicted one (its queued tasks may then be
+    // taken out of order with its new ones).
+    static constexpr std::size_t kMaxHomes = 16;
+
+    // This thread's shard in this scheduler. Keyed by a per-instance ID rather than `this`:
+    // IDs are never reused, so a thread switching between schedulers keeps each home and a
+    // scheduler allocated at a recycled address does not inherit a stale one.
+    std::size_t homeShard()
+    {
+        struct Home
+        {
+            std::uint64_t owner;
+            std::size_t shard;
+        };
+        thread_local std::vector<Home> homes;
+
+        if (!homes.empty() && homes.front().owner == id_) return homes.front().shard;
+        for (std::size_t i = 1; i < homes.size(); ++i)
+        {
+            if (homes[i].owner != id_) continue;
+            std::rotate(homes.begin(), homes.begin() + static_cast<std::ptrdiff_t>(i),
+                        homes.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+            return homes.front().shard;
+        }
+
+        const std::size_t shard = nextHome_.fetch_add(1, std::memory_order_relaxed) % locals_.size();
+        if (homes.size() == kMaxHomes) homes.pop_back();
+        homes.insert(homes.begin(), Home{id_, shard});
+        return shard;
+    }
+
+    // Home shard first, then steal from the other shards.
+    std::optional<Task> popAny(std::size_t home)
+    {
+        if (auto t = popFrom(*locals_[home])) return t;
+
+        for (std::size_t i = 1; i < locals_.size(); ++i)
+        {
+            if (auto t = popFrom(*locals_[(home + i) % locals_.size()]))
+                return t;
+        }
+        return std::nullopt;
+    }
+
+    // Same visiting order as popAny(), taking up to `max` tasks with one lock per shard.
+    std::size_t popMany(std::size_t home, std::size_t max, std::vector<Task>& out)
+    {
+        std::size_t got = popInto(*locals_[home], max, out);
+
+        for (std::size_t i = 1; i < locals_.size() && got < max; ++i)
+            got += popInto(*locals_[(home + i) % locals_.size()], max - got, out);
+        return got;
+    }
+
+    std::size_t popInto(Shard& s, std::size_t max, std::vector<Task>& out)
+    {
+        if (s.count.load(std::memory_order_acquire) == 0) return 0;
+
+        std::size_t taken = 0;
+        const std::size_t before = out.size();
+        {
+            std::lock_guard<std::mutex> lock(s.mtx);
+            while (taken < max && !s.q.empty())
+            {
+                out.push_back(std::move(s.q.front()));
+                s.q.pop_front();
+                ++taken;
+            }
+            s.count.fetch_sub(taken, std::memory_order_release);
+        }
+        pending_.fetch_sub(taken, std::memory_order_acq_rel);
+
+        // Drop canceled ones in place (one-time markers), preserving order.
+        if (cancelMarkers_.load(std::memory_order_relaxed) > 0)
+        {
+            auto first = out.begin() + static_cast<std::ptrdiff_t>(before);
+            out.erase(std::remove_if(first, out.end(),
+                                     [&](const Task& t) { return consumeCancelMarker(t.task_id); }),
+                      out.end());
+        }
+        return out.size() - before;
+    }
+
+    // Pop one FIFO task from a shard, skipping canceled ones (one-time marker).
+    std::optional<Task> popFrom(Shard& s)
+    {
+        while (s.count.load(std::memory_order_acquire) > 0)
+        {
+            Task t;
+            {
+                std::lock_guard<std::mutex> lock(s.mtx);
+                if (s.q.empty()) return std::nullopt;
+                t = std::move(s.q.front());
+                s.q.pop_front();
+                s.count.fetch_sub(1, std::memory_order_release);
+            }
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+
+            if (consumeCancelMarker(t.task_id))
+                continue;
+
+            return t;
+        }
+        return std::nullopt;
+    }
+
+
+    // Cancel markers are rare; avoid the shared lock entirely when there are none.
+    bool consumeCancelMarker(const std::string& taskId)
+    {
+        if (cancelMarkers_.load(std::memory_order_relaxed) == 0) return false;
+        std::lock_guard<std::mutex> lock(cancelMtx_);
+        if (!canceled_.erase(taskId)) return false;
+        cancelMarkers_.fetch_sub(1, std::memory_order_relaxed);
+        metrics_.add(metrics::Counter::CanceledSkipped);
+        return true;
+    }
+
+private:
+    static inline std::atomic<std::uint64_t> nextId_{1};
+
+    std::vector<std::unique_ptr<Shard>> locals_;
+    const std::uint64_t id_ = nextId_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic<std::size_t> nextHome_{0};
+    std::atomic<std::size_t> pending_{0};
+
+    std::mutex cancelMtx_;
+    std::unordered_set<std::string> canceled_;
+    std::atomic<std::size_t> cancelMarkers_{0};
+
+    AdaptiveSpinner spinner_;
+    Parker parker_;
+    std::atomic<bool> shutdown_{false};
+
+    SchedulerMetrics& metrics_; // owned by FifoTaskScheduler
+};
+
+// --------- Bounded lock-free MPMC ring (internal) ---------
+// Classic sequence-numbered slots: a slot is writable when seq == pos and readable
+// when seq == pos + 1. Producers and consumers only contend on their own cursor.
+template <typename T>
+class MpmcRing
+{
+public:
+    explicit MpmcRing(std::size_t capacity)
+    {
+        std::size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        cells_ = std::make_unique<Cell[]>(cap);
+        for (std::size_t i = 0; i < cap; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    // Moves from `v` only on success, so a full ring leaves the caller's value intact.
+    bool tryPush(T& v)
+    {
+        std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& c = cells_[pos & mask_];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    c.value = std::move(v);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& out)
+    {
+        std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& c = cells_[pos & mask_];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    out = std::move(c.value);
+                    c.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate under concurrency; exact when quiescent.
+    std::size_t size() const noexcept
+    {
+        std::size_t tail = enqueuePos_.load(std::memory_order_acquire);
+        std::size_t head = dequeuePos_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> seq{0};
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_ = 0;
+
+    alignas(64) std::atomic<std::size_t> enqueuePos_{0};
+    alignas(64) std::atomic<std::size_t> dequeuePos_{0};
+};
+
+// --------- Ring backend (internal) ---------
+// Bounded: trySubmit() fails fast when full, submit() blocks until a slot frees up.
+class RingQueue
+{
+public:
+    RingQueue(std::size_t capacity, SchedulerMetrics& metrics) : ring_(capacity), metrics_(metrics) {}
+
+    bool trySubmit(Task& t)
+    {
+        reviveIfCanceled(t.task_id);
+        return tryEnqueue(t, /*wake=*/true);
+    }
+
+    bool submit(Task t)
+    {
+        reviveIfCanceled(t.task_id);
+        return pushBlocking(t, /*wake=*/true);
+    }
+
+    // submit() without reviving a cancel marker (used for tasks released by timers).
+    bool enqueue(Task t)
+    {
+        return pushBlocking(t, /*wake=*/true);
+    }
+
+
+    // Blocks per task while the ring is full; consumers are woken once for the whole batch.
+    std::size_t submitBatch(Task* tasks, std::size_t count)
+    {
+        std::size_t accepted = 0;
+        for (; accepted < count; ++accepted)
+        {
+            reviveIfCanceled(tasks[accepted].task_id);
+            if (!pushBlocking(tasks[accepted], /*wake=*/false))
+                break;
+            // Don't let a long batch stall behind a full ring with every worker asleep.
+            if (accepted + 1 < count && ring_.size() == ring_.capacity())
+                consumers_.wake(ring_.capacity());
+        }
+        consumers_.wake(accepted);
+        return accepted;
+    }
+
+    bool cancel(const std::string& taskId)
+    {
+        std::lock_guard<std::mutex> lock(cancelMtx_);
+        if (!canceled_.insert(taskId).second) return false;
+        cancelMarkers_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::optional<Task> tryGetNext()
+    {
+        if (shutdown_.load(std::memory_order_acquire)) return std::nullopt;
+        return popOne();
+    }
+
+    std::size_t getNextBatch(std::size_t max, std::vector<Task>& out)
+    {
+        for (;;)
+        {
+            if (shutdown_.load(std::memory_order_acquire) || max == 0) return 0;
+
+            for (int spin = 0, n = consumerSpin_.budget(); spin < n; ++spin)
+            {
+                std::size_t got = 0;
+                while (got < max)
+                {
+                    auto t = popOne();
+                    if (!t) break;
+                    out.push_back(std::move(*t));
+                    ++got;
+                }
+                if (got > 0)
+                {
+                    if (spin > 0) consumerSpin_.onSpinHit();
+                    return got;
+                }
+                std::this_thread::yield();
+            }
+
+            consumerSpin_.onPark();
+            const metrics::Clock::time_point start = metrics::now();
+            consumers_.park([&] {
+                return shutdown_.load(std::memory_order_acquire) || ring_.size() > 0;
+            });
+            metrics_.recordSince(metrics::Histogram::WorkWaitNs, start);
+        }
+    }
+
+    std::optional<Task> getNext()
+    {
+        for (;;)
+        {
+            if (shutdown_.load(std::memory_order_acquire)) return std::nullopt;
+
+            for (int spin = 0, n = consumerSpin_.budget(); spin < n; ++spin)
+            {
+                if (auto t = popOne())
+                {
+                    if (spin > 0) consumerSpin_.onSpinHit();
+                    return t;
+                }
+                std::this_thread::yield();
+            }
+
+            consumerSpin_.onPark();
+            const metrics::Clock::time_point start = metrics::now();
+            consumers_.park([&] {
+                return shutdown_.load(std::memory_order_acquire) || ring_.size() > 0;
+            });
+            metrics_.recordSince(metrics::Histogram::WorkWaitNs, start);
+        }
+    }
+
+    void shutdown()
+    {
+        consumers_.wakeAll([&] { shutdown_.store(true, std::memory_order_release); });
+        producers_.wakeAll([] {});
+    }
+
+    bool empty() const { return ring_.size() == 0; }
+    std::size_t size() const { return ring_.size(); }
+
+    // Clears a pending cancel marker for an ID being submitted again.
+    void reviveIfCanceled(const std::string& taskId)
+    {
+        if (cancelMarkers_.load(std::memory_order_relaxed) == 0) return;
+        std::lock_guard<std::mutex> lock(cancelMtx_);
+        if (canceled_.erase(taskId))
+            cancelMarkers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    bool tryEnqueue(Task& t, bool wake)
+    {
+        if (shutdown_.load(std::memory_order_acquire)) return false;
+        if (!ring_.tryPush(t)) return false;
+        if (wake) consumers_.wakeOne();
+        return true;
+    }
+
+    bool pushBlocking(Task& t, bool wake)
+    {
+        for (;;)
+        {
+            if (shutdown_.load(std::memory_order_acquire)) return false;
+
+            for (int spin = 0, n = producerSpin_.budget(); spin < n; ++spin)
+            {
+                if (tryEnqueue(t, wake))
+                {
+                    if (spin > 0) producerSpin_.onSpinHit();
+                    return true;
+                }
+                if (shutdown_.load(std::memory_order_acquire)) return false;
+                std::this_thread::yield();
+            }
+
+            producerSpin_.onPark();
+            producers_.park([&] {
+                return shutdown_.load(std::memory_order_acquire) ||
+                       ring_.size() < ring_.capacity();
+            });
+        }
+    }
+
+    std::optional<Task> popOne()
+    {
+        Task t;
+        while (ring_.tryPop(t))
+        {
+            producers_.wakeOne();
+            if (consumeCancelMarker(t.task_id))
+                continue;
+            return t;
+        }
+        return std::nullopt;
+    }
+
+
+    bool consumeCancelMarker(const std::string& taskId)
+    {
+        if (cancelMarkers_.load(std::memory_order_relaxed) == 0) return false;
+        std::lock_guard<std::mutex> lock(cancelMtx_);
+        if (!canceled_.erase(taskId)) return false;
+        cancelMarkers_.fetch_sub(1, std::memory_order_relaxed);
+        metrics_.add(metrics::Counter::CanceledSkipped);
+        return true;
+    }
+
+private:
+    MpmcRing<Task> ring_;
+
+    std::mutex cancelMtx_;
+    std::unordered_set<std::string> canceled_;
+    std::atomic<std::size_t> cancelMarkers_{0};
+
+    AdaptiveSpinner consumerSpin_, producerSpin_;
+    Parker consumers_, producers_;
+    std::atomic<bool> shutdown_{false};
+
+    SchedulerMetrics& metrics_; // owned by FifoTaskScheduler
+};
+
+// --------- Delayed-task feeder for the lock-light backends (internal) ---------
+// Started on the first submitAt(); sleeps until the nearest deadline, then hands due
+// tasks to `release` outside its own lock (release may block on a full ring).
+class DelayedFeeder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit DelayedFeeder(std::function<bool(Task)> release) : release_(std::move(release)) {}
+
+    // The owner shuts its backend down first, so a release_ blocked on a full ring returns.
+    ~DelayedFeeder() { stop(); }
+
+    // Returns false once stopped.
+    bool schedule(Task t, Clock::time_point due)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (stop_) return false;
+            wheel_.schedule(std::move(t), due);
+            if (!thread_.joinable())
+                thread_ = std::thread([this] { run(); });
+        }
+        cv_.notify_one(); // the new deadline may be earlier than the one being slept on
+        return true;
+    }
+
+    // Drops whatever is still delayed. Joins the feeder thread: whatever release_ is blocked
+    // on (a full ring) must be unblocked first.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return wheel_.size() + inFlight_;
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        std::vector<Task> due;
+        while (!stop_)
+        {
+            wheel_.advance(Clock::now(), [&](Task&& t) { due.push_back(std::move(t)); });
+            if (!due.empty())
+            {
+                inFlight_ = due.size();
+                lock.unlock();
+                for (Task& t : due)
+                    release_(std::move(t));
+                due.clear();
+                lock.lock();
+                inFlight_ = 0;
+                continue;
+            }
+
+            if (auto next = wheel_.nextDeadline())
+                cv_.wait_until(lock, *next);
+            else
+                cv_.wait(lock);
+        }
+    }
+
+    std::function<bool(Task)> release_;
+    TimingWheel<Task> wheel_;
+    std::size_t inFlight_ = 0;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+// --------- SingleQueue backend: QueuePolicy for Scheduler (scheduler_core.h) ---------
+// One intrusive list in arrival order; no tenants, so nothing is ever rate limited.
+class FifoQueue
+{
+public:
+    using Nodes = TaskNodes<Task>;
+
+    static constexpr bool kTenants = false;
+    static constexpr const char* kName = "fifo";
+
+    void normalize(Task&) const {}
+
+    void push(Nodes& nodes, TaskIdTable::Handle handle) { q_.pushBack(nodes, handle); }
+    void unlink(Nodes& nodes, TaskIdTable::Handle handle) { q_.unlink(nodes, handle); }
+
+    // Pop the oldest task.
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> pop(Nodes& nodes, Admit&, SchedulerMetrics&)
+    {
+        if (q_.empty()) return std::nullopt;
+
+        const TaskIdTable::Handle handle = q_.head;
+        q_.unlink(nodes, handle);
+        return handle;
+    }
+
+    void unpark(std::size_t, IdInterner::Handle) {}
+
+    bool empty() const noexcept { return q_.empty(); }
+    std::size_t size() const noexcept { return q_.size; }
+    bool runnable() const noexcept { return !q_.empty(); }
+
+    // No tenants: the depth gauge is the whole queue.
+    template <typename Fn>
+    void forEachLane(Fn&& fn) const { fn(-1, 0, q_.size); }
+
+private:
+    IntrusiveList q_;
+};
+
+class FifoTaskScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FifoTaskScheduler() : FifoTaskScheduler(FifoOptions{}) {}
+
+    explicit FifoTaskScheduler(FifoOptions opts)
+    {
+        if (opts.backend == FifoBackend::WorkStealing)
+            stealing_ = std::make_unique<WorkStealingQueues>(opts.shards, metrics_);
+        else if (opts.backend == FifoBackend::Ring)
+            ring_ = std::make_unique<RingQueue>(opts.ringCapacity, metrics_);
+        else
+            single_ = std::make_unique<Scheduler<FifoQueue>>();
+    }
+
+    // The feeder may be blocked pushing into a full ring: shut the backend down before the
+    // feeder is joined.
+    ~FifoTaskScheduler()
+    {
+        if (!single_) shutdown();
+    }
+
+    FifoTaskScheduler(const FifoTaskScheduler&) = delete;
+    FifoTaskScheduler& operator=(const FifoTaskScheduler&) = delete;
+
+    // Submit task into FIFO queue. Returns false if scheduler is shutdown, or if an attached
+    // log failed to persist it (queued all the same; see Scheduler::submit).
+    // Ring backend: blocks while the ring is full (backpressure).
+    bool submit(Task t)
+    {
+        if (single_) return single_->submit(std::move(t));
+        if (stealing_) return counted(metrics::Counter::Submitted, stealing_->submit(std::move(t)));
+        return counted(metrics::Counter::Submitted, ring_->submit(std::move(t)));
+    }
+
+    // Holds the task until `due`, then queues it like submit(). Returns false if shutdown.
+    bool submitAt(Task t, Clock::time_point due)
+    {
+        if (single_) return single_->submitAt(std::move(t), due);
+        DelayedFeeder* f = feeder();
+        if (!f) return false; // shut down
+        if (stealing_) stealing_->reviveIfCanceled(t.task_id);
+        else ring_->reviveIfCanceled(t.task_id);
+        return counted(metrics::Counter::Submitted, f->schedule(std::move(t), due));
+    }
+
+    template <typename Rep, typename Period>
+    bool submitAfter(Task t, std::chrono::duration<Rep, Period> delay)
+    {
+        return submitAt(std::move(t), Clock::now() + delay);
+    }
+
+    // Batch submit: tasks are moved from; one lock acquisition for the whole batch and
+    // at most `count` idle workers woken. Returns how many were accepted (0 if shutdown,
+    // or if an attached log failed to persist the batch).
+    std::size_t submitBatch(Task* tasks, std::size_t count)
+    {
+        if (single_) return single_->submitBatch(tasks, count);
+        if (stealing_) return counted(metrics::Counter::Submitted, stealing_->submitBatch(tasks, count));
+        return counted(metrics::Counter::Submitted, ring_->submitBatch(tasks, count));
+    }
+
+    // SingleQueue only (see Scheduler::submit with deps): queued once every dep has
+    // completed. Returns false on the lock-free backends, which keep no dependency graph.
+    bool submit(Task t, const std::vector<std::string>& deps)
+    {
+        if (single_) return single_->submit(std::move(t), deps);
+        return false;
+    }
+
+    // SingleQueue only (see Scheduler::submitGraph).
+    bool submitGraph(std::vector<DependentTask>& tasks)
+    {
+        if (single_) return single_->submitGraph(tasks);
+        return false;
+    }
+
+    // Like submit(), but never blocks: returns false if the ring is full (Ring backend)
+    // or the scheduler is shutdown. Unbounded backends behave exactly like submit().
+    bool trySubmit(Task t)
+    {
+        if (ring_) return counted(metrics::Counter::Submitted, ring_->trySubmit(t));
+        return submit(std::move(t));
+    }
+
+    // SingleQueue: unlinks the queued (or drops the delayed) task in O(1); returns false if
+    // no such task is queued or delayed.
+    // Other backends: lazy marker, skipped once when the task reaches the head.
+    bool cancel(const std::string& taskId)
+    {
+        if (single_) return single_->cancel(taskId);
+        if (stealing_) return counted(metrics::Counter::Canceled, stealing_->cancel(taskId));
+        return counted(metrics::Counter::Canceled, ring_->cancel(taskId));
+    }
+
+    // Non-blocking.
+    std::optional<Task> tryGetNext()
+    {
+        if (single_) return single_->tryGetNext();
+        if (stealing_) return dispatched(stealing_->tryGetNext());
+        return dispatched(ring_->tryGetNext());
+    }
+
+    // Blocking.
+    std::optional<Task> getNext()
+    {
+        if (single_) return single_->getNext();
+        if (stealing_) return dispatched(stealing_->getNext());
+        return dispatched(ring_->getNext());
+    }
+
+    // SingleQueue only (see Scheduler::next): awaitable getNext() for C++20 coroutines.
+    template <typename Executor>
+    NextAwaiter<FifoTaskScheduler, Executor> next(Executor& ex)
+    {
+        return NextAwaiter<FifoTaskScheduler, Executor>(*this, ex);
+    }
+
+    // The lock-free backends have no waiter list: they answer nullopt at once, as on shutdown.
+    bool getNextAsync(TaskWaiter& w)
+    {
+        if (single_) return single_->getNextAsync(w);
+        return true;
+    }
+
+    std::optional<Clock::time_point> pollAsync()
+    {
+        if (single_) return single_->pollAsync();
+        return std::nullopt;
+    }
+
+    void setAsyncWakeHook(std::function<void()> hook)
+    {
+        if (single_) single_->setAsyncWakeHook(std::move(hook));
+    }
+
+    // Blocking batch dequeue: waits for at least one task, then appends up to `max`
+    // tasks to `out` in FIFO order. Returns the number appended (0 on shutdown).
+    std::size_t getNextBatch(std::size_t max, std::vector<Task>& out)
+    {
+        if (single_) return single_->getNextBatch(max, out);
+        if (stealing_) return dispatchedTail(out, stealing_->getNextBatch(max, out));
+        return dispatchedTail(out, ring_->getNextBatch(max, out));
+    }
+
+    void shutdown()
+    {
+        if (single_) { single_->shutdown(); return; }
+
+        // Backend first: a feeder blocked in a full ring's pushBlocking() only returns once
+        // the ring is shut down. Then stop the feeder, if one was ever started.
+        if (stealing_) stealing_->shutdown();
+        else ring_->shutdown();
+
+        DelayedFeeder* f = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(feederMtx_);
+            feederStopped_ = true; // later submitAt() calls fail
+            f = feeder_.get();
+        }
+        if (f) f->stop();
+    }
+
+    bool empty() const
+    {
+        if (single_) return single_->empty();
+        if (stealing_) return stealing_->empty();
+        return ring_->empty();
+    }
+
+    std::size_t size() const
+    {
+        if (single_) return single_->size();
+        if (stealing_) return stealing_->size();
+        return ring_->size();
+    }
+
+    // Retries are off until a policy with maxAttempts > 0 is set (retry_policy.h). With a
+    // policy, every dispatched task stays tracked until complete() or fail() reports on it.
+    void setRetryPolicy(RetryPolicy policy)
+    {
+        if (single_) single_->setRetryPolicy(policy);
+        else retries_.setPolicy(policy);
+    }
+
+    // Worker report for a task it got from getNext(). Failed is the same as fail().
+    // Returns false if the task is not in flight.
+    bool complete(const std::string& taskId, TaskStatus status = TaskStatus::Succeeded)
+    {
+        if (single_) return single_->complete(taskId, status);
+        if (status == TaskStatus::Failed) return fail(taskId);
+        return retries_.complete(taskId);
+    }
+
+    // Resubmits the failed task (attempt + 1) after a jittered exponential backoff, or moves
+    // it to the dead-letter queue once it has used maxAttempts runs (or on shutdown).
+    // The retry goes to the queue tail via submitAfter() on every backend.
+    // Returns false if the task is not in flight.
+    bool fail(const std::string& taskId)
+    {
+        if (single_) return single_->fail(taskId);
+
+        std::optional<RetryTracker<Task>::Retry> retry;
+        if (retries_.fail(taskId, retry) == RetryTracker<Task>::Outcome::Unknown) return false;
+
+        if (retry && submitAfter(retry->task, retry->delay))
+        {
+            metrics_.add(metrics::Counter::Retried);
+            return true;
+        }
+        if (retry) retries_.deadLetter(std::move(retry->task));
+        metrics_.add(metrics::Counter::DeadLettered);
+        return true;
+    }
+
+    // SingleQueue only (see Scheduler::attachLog): replays `log`, then logs to it. Returns
+    // the tasks recovered, or nullopt on the lock-free backends, which don't log.
+    template <typename Log>
+    std::optional<std::size_t> attachLog(Log& log)
+    {
+        if (single_) return single_->attachLog(log);
+        return std::nullopt;
+    }
+
+    // Tasks that failed maxAttempts times, oldest first; the queue is emptied.
+    std::vector<Task> drainDeadLetters()
+    {
+        if (single_) return single_->drainDeadLetters();
+        return retries_.drainDeadLetters();
+    }
+
+    std::size_t deadLetterSize() const
+    {
+        if (single_) return single_->deadLetterSize();
+        return retries_.deadLetterSize();
+    }
+
+    // Tasks waiting on submitAt/submitAfter deadlines (not counted by size()).
+    std::size_t delayedSize() const
+    {
+        if (single_) return single_->delayedSize();
+        std::lock_guard<std::mutex> lock(feederMtx_);
+        return feeder_ ? feeder_->size() : 0;
+    }
+
+    // Tasks waiting on deps (SingleQueue only; not counted by size()).
+    std::size_t blockedSize() const
+    {
+        if (single_) return single_->blockedSize();
+        return 0;
+    }
+
+    // Counters and wait histograms (see scheduler_metrics.h). FIFO has no tenants, so the
+    // depth gauge is the whole queue.
+    metrics::Snapshot metricsSnapshot() const
+    {
+        if (single_) return single_->metricsSnapshot();
+        metrics::Snapshot s = metrics_.snapshot();
+        s.depth.push_back(metrics::DepthGauge{"", -1, size()});
+        return s;
+    }
+
+    // metricsSnapshot() in Prometheus text exposition format.
+    std::string metricsText() const { return metrics::toPrometheus(metricsSnapshot(), FifoQueue::kName); }
+
+private:
+    // Adds `n` (a bool counts as 0 or 1) to counter `c` and passes it through.
+    template <typename N>
+    N counted(metrics::Counter c, N n)
+    {
+        metrics_.add(c, static_cast<std::uint64_t>(n));
+        return n;
+    }
+
+    // Every task handed to a worker passes through here: counted and tracked for retries.
+    std::optional<Task> dispatched(std::optional<Task> t)
+    {
+        if (t) metrics_.add(metrics::Counter::Dequeued);
+        return retries_.track(std::move(t));
+    }
+
+    std::size_t dispatchedTail(std::vector<Task>& out, std::size_t n)
+    {
+        metrics_.add(metrics::Counter::Dequeued, n);
+        return retries_.trackTail(out, n);
+    }
+
+    // Started on first use; nullptr once shut down.
+    DelayedFeeder* feeder()
+    {
+        std::lock_guard<std::mutex> lock(feederMtx_);
+        if (feederStopped_) return nullptr;
+        if (!feeder_)
+        {
+            feeder_ = std::make_unique<DelayedFeeder>([this](Task t) {
+                metrics_.add(metrics::Counter::DelayedReleased);
+                return stealing_ ? stealing_->enqueue(std::move(t)) : ring_->enqueue(std::move(t));
+            });
+        }
+        return feeder_.get();
+    }
+
+private:
+    std::unique_ptr<Scheduler<FifoQueue>> single_; // set => SingleQueue backend (own metrics and retries)
+
+    // WorkStealing/Ring only from here on.
+    RetryTracker<Task> retries_;
+
+    // Before the backends: they hold a reference to it.
+    mutable SchedulerMetrics metrics_;
+
+    std::unique_ptr<WorkStealingQueues> stealing_; // set => WorkStealing backend
+    std::unique_ptr<RingQueue> ring_;              // set => Ring backend
+
+    // Declared after the backends so it is destroyed (and its thread joined) first.
+    mutable std::mutex feederMtx_;
+    std::unique_ptr<DelayedFeeder> feeder_;
+    bool feederStopped_ = false;
+};
@@ -0,0 +1,152 @@
+// id_interner.h
+// C++17, STL only
+//
+// Dense 32-bit handles for the string IDs the schedulers carry around.
+// Strings are hashed once at submit time; everything after that works on integers.
+//
+//   IdInterner  : permanent string <-> handle mapping (tenants: small, long-lived set).
+//   TaskIdTable : recycled handles for in-flight task IDs.
+//                 release() is O(1) and never hashes; the stale index entry is cleaned up
+//                 when the slot is reused by the next acquire().
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "slab_allocator.h"
+
+// Hash map whose nodes come from the slab allocator (see slab_allocator.h).
+template <typename K, typename V>
+using SlabHashMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>,
+                                       SlabAllocator<std::pair<const K, V>>>;
+
+class IdInterner
+{
+public:
+    using Handle = std::uint32_t;
+
+    Handle intern(const std::string& id)
+    {
+        auto [it, inserted] = ids_.try_emplace(id, static_cast<Handle>(names_.size()));
+        if (inserted)
+            names_.push_back(&it->first); // node-based map: key address is stable
+        return it->second;
+    }
+
+    std::optional<Handle> find(const std::string& id) const
+    {
+        auto it = ids_.find(id);
+        if (it == ids_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    // Reverse lookup for reporting.
+    const std::string& name(Handle h) const { return *names_[h]; }
+
+    std::size_t size() const noexcept { return names_.size(); }
+
+private:
+    SlabHashMap<std::string, Handle> ids_;
+    std::vector<const std::string*> names_;
+};
+
+class TaskIdTable
+{
+public:
+    using Handle = std::uint32_t;
+
+    // Called once per submit. Hashes the ID (plus the stale key of a recycled slot).
+    Handle acquire(const std::string& taskId)
+    {
+        const Handle h = takeSlot();
+        Slot& s = slots_[h];
+        s.key = taskId;
+        s.indexed = true;
+        index_[s.key] = h; // a duplicate live ID now resolves to the newest submission
+        return h;
+    }
+
+    // Room for `n` in-flight tasks without rehashing (bulk loads such as log replay).
+    void reserve(std::size_t n)
+    {
+        slots_.reserve(n);
+        index_.reserve(n);
+    }
+
+    // For schedulers without cancel(): the ID is neither copied nor hashed, and
+    // findLive() never returns the handle.
+    Handle acquireUnindexed()
+    {
+        const Handle h = takeSlot();
+        slots_[h].key.clear();
+        slots_[h].indexed = false;
+        return h;
+    }
+
+    std::optional<Handle> findLive(const std::string& taskId) const
+    {
+        auto it = index_.find(taskId);
+        if (it == index_.end() || !slots_[it->second].live) return std::nullopt;
+        return it->second;
+    }
+
+    // Called once per pop or cancel. Integer-only.
+    void release(Handle h)
+    {
+        slots_[h].live = false;
+        free_.push_back(h);
+    }
+
+    bool isLive(Handle h) const { return slots_[h].live; }
+
+    // Bumped on every acquire, so (handle, generation) identifies one submission even
+    // after the handle is recycled. Lets timers and other side structures detect staleness.
+    std::uint32_t generation(Handle h) const { return slots_[h].generation; }
+
+    const std::string& name(Handle h) const { return slots_[h].key; }
+
+private:
+    struct Slot
+    {
+        std::string key;
+        bool live = false;
+        bool indexed = false; // key has an index_ entry (possibly stale)
+        std::uint32_t generation = 0;
+    };
+
+    // Pops a free slot (dropping its stale index entry) or appends one; marks it live.
+    Handle takeSlot()
+    {
+        Handle h;
+        if (!free_.empty())
+        {
+            h = free_.back();
+            free_.pop_back();
+
+            if (slots_[h].indexed)
+            {
+                auto stale = index_.find(slots_[h].key);
+                if (stale != index_.end() && stale->second == h)
+                    index_.erase(stale);
+            }
+        }
+        else
+        {
+            h = static_cast<Handle>(slots_.size());
+            slots_.emplace_back();
+        }
+
+        slots_[h].live = true;
+        ++slots_[h].generation;
+        return h;
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<Handle> free_;
+
+    SlabHashMap<std::string, Handle> index_; // one node per in-flight task: churns every submit
+};
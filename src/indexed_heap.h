@@ -0,0 +1,139 @@
+// indexed_heap.h
+// C++17, STL only
+//
+// Indexed d-ary min-heap over task handles (TaskIdTable handles), for the deadline queue
+// (priority_scheduler.h).
+//
+// - Each handle's heap position is kept in pos_, so erase(handle) (cancel) and
+//   update(handle, key) (aging promotion) are O(log n) instead of a linear search.
+// - D = 4 by default: a shallower tree than a binary heap, and a node's children sit in one
+//   or two cache lines, which makes sift-down (every pop) cheaper at the cost of a few
+//   more compares per level.
+// - Key needs operator<. Ties pop in no particular order; put a sequence number in the
+//   key if that matters.
+// - Not thread-safe: callers guard it with their own lock.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "id_interner.h"
+
+template <typename Key, unsigned D = 4>
+class IndexedDaryHeap
+{
+    static_assert(D >= 2, "a heap needs at least two children per node");
+
+public:
+    using Handle = TaskIdTable::Handle;
+
+    bool empty() const noexcept { return heap_.empty(); }
+    std::size_t size() const noexcept { return heap_.size(); }
+
+    bool contains(Handle h) const noexcept { return h < pos_.size() && pos_[h] != npos; }
+
+    // Handle with the smallest key. Heap must not be empty.
+    Handle top() const { return heap_.front(); }
+
+    const Key& key(Handle h) const { return keys_[h]; }
+
+    // `h` must not be in the heap yet.
+    void push(Handle h, Key k)
+    {
+        if (h >= pos_.size())
+        {
+            pos_.resize(h + 1, npos);
+            keys_.resize(h + 1);
+        }
+        keys_[h] = std::move(k);
+        pos_[h] = static_cast<std::uint32_t>(heap_.size());
+        heap_.push_back(h);
+        siftUp(pos_[h]);
+    }
+
+    Handle pop()
+    {
+        const Handle h = heap_.front();
+        erase(h);
+        return h;
+    }
+
+    // Removes `h` (must be in the heap) from anywhere in it.
+    void erase(Handle h)
+    {
+        const std::uint32_t i = pos_[h];
+        const Handle last = heap_.back();
+        heap_.pop_back();
+        pos_[h] = npos;
+        if (last == h) return;
+
+        heap_[i] = last;
+        pos_[last] = i;
+        if (i > 0 && keys_[last] < keys_[heap_[parent(i)]]) siftUp(i);
+        else siftDown(i);
+    }
+
+    // New key for `h` (must be in the heap), smaller or larger.
+    void update(Handle h, Key k)
+    {
+        const bool smaller = k < keys_[h];
+        keys_[h] = std::move(k);
+        if (smaller) siftUp(pos_[h]);
+        else siftDown(pos_[h]);
+    }
+
+private:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    static std::size_t parent(std::size_t i) { return (i - 1) / D; }
+
+    // Hole-based: the moving handle is written once, at its final slot.
+    void siftUp(std::size_t i)
+    {
+        const Handle h = heap_[i];
+        while (i > 0)
+        {
+            const std::size_t p = parent(i);
+            if (!(keys_[h] < keys_[heap_[p]])) break;
+            place(i, heap_[p]);
+            i = p;
+        }
+        place(i, h);
+    }
+
+    void siftDown(std::size_t i)
+    {
+        const Handle h = heap_[i];
+        const std::size_t n = heap_.size();
+        for (;;)
+        {
+            const std::size_t first = i * D + 1;
+            if (first >= n) break;
+
+            std::size_t best = first;
+            const std::size_t end = first + D < n ? first + D : n;
+            for (std::size_t c = first + 1; c < end; ++c)
+            {
+                if (keys_[heap_[c]] < keys_[heap_[best]]) best = c;
+            }
+            if (!(keys_[heap_[best]] < keys_[h])) break;
+            place(i, heap_[best]);
+            i = best;
+        }
+        place(i, h);
+    }
+
+    void place(std::size_t i, Handle h)
+    {
+        heap_[i] = h;
+        pos_[h] = static_cast<std::uint32_t>(i);
+    }
+
+    std::vector<Handle> heap_;
+    std::vector<std::uint32_t> pos_; // indexed by handle; npos when not in the heap
+    std::vector<Key> keys_;          // indexed by handle; stale when not in the heap
+};
@@ -0,0 +1,98 @@
+// intrusive_task_list.h
+// C++17, STL only
+//
+// Pooled nodes + intrusive doubly-linked lists for queued tasks.
+// Nodes are addressed by the TaskIdTable handle of the task they hold, so
+// cancel(taskId) is: one index lookup, then an O(1) unlink. No tombstones.
+//
+//   TaskNodes<TaskT> : node storage indexed by handle, in fixed-size pages so growth
+//                      never moves queued tasks (grows, never shrinks).
+//   IntrusiveList    : head/tail/size over those nodes; one per lane.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "id_interner.h"
+
+template <typename TaskT>
+class TaskNodes
+{
+public:
+    using Handle = TaskIdTable::Handle;
+    static constexpr Handle npos = std::numeric_limits<Handle>::max();
+
+    struct Node
+    {
+        TaskT task{};
+        Handle prev = npos;
+        Handle next = npos;
+        std::uint32_t lane = 0; // owner lane (tenant handle, or 0 for a single queue)
+        bool linked = false;    // false while parked outside any list (e.g. a delayed task)
+    };
+
+    Node& operator[](Handle h) { return pages_[h >> kPageShift][h & kPageMask]; }
+    const Node& operator[](Handle h) const { return pages_[h >> kPageShift][h & kPageMask]; }
+
+    // Handles are dense, so this only grows with peak in-flight tasks.
+    Node& emplace(Handle h, TaskT t, std::uint32_t lane)
+    {
+        while ((h >> kPageShift) >= pages_.size())
+            pages_.push_back(std::make_unique<Node[]>(kPageSize));
+        Node& n = (*this)[h];
+        n.task = std::move(t);
+        n.prev = n.next = npos;
+        n.lane = lane;
+        n.linked = false;
+        return n;
+    }
+
+private:
+    static constexpr unsigned kPageShift = 8;
+    static constexpr std::size_t kPageSize = std::size_t{1} << kPageShift;
+    static constexpr Handle kPageMask = kPageSize - 1;
+
+    std::vector<std::unique_ptr<Node[]>> pages_;
+};
+
+struct IntrusiveList
+{
+    using Handle = TaskIdTable::Handle;
+    static constexpr Handle npos = std::numeric_limits<Handle>::max();
+
+    Handle head = npos;
+    Handle tail = npos;
+    std::size_t size = 0;
+
+    bool empty() const noexcept { return size == 0; }
+
+    template <typename Nodes>
+    void pushBack(Nodes& nodes, Handle h)
+    {
+        auto& n = nodes[h];
+        n.prev = tail;
+        n.next = npos;
+        n.linked = true;
+        if (tail != npos) nodes[tail].next = h;
+        else head = h;
+        tail = h;
+        ++size;
+    }
+
+    template <typename Nodes>
+    void unlink(Nodes& nodes, Handle h)
+    {
+        auto& n = nodes[h];
+        if (n.prev != npos) nodes[n.prev].next = n.next;
+        else head = n.next;
+        if (n.next != npos) nodes[n.next].prev = n.prev;
+        else tail = n.prev;
+        n.prev = n.next = npos;
+        n.linked = false;
+        --size;
+    }
+};
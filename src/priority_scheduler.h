@@ -0,0 +1,466 @@
+// priority_scheduler.h
+// C++17, STL only
+//
+// Priority scheduler with starvation protection via budgets (weighted service).
+// SAME style/API as fifo_scheduler.h and fair_scheduler.h:
+//
+//   submit(Task)
+//   cancel(task_id)
+//   tryGetNext()
+//   getNext()
+//   shutdown()
+//
+// Design:
+// - PriorityTaskScheduler<N, WaitPolicy> is Scheduler<PriorityBands<N>, WaitPolicy> (scheduler_core.h): the core
+//   brings the lock, blocking, cancel, delays, retries, rate limits and metrics;
+//   PriorityBands<N> picks the band and each band's TenantRing (tenant_ring.h) the tenant.
+// - N priority bands: P0 (highest) .. P(N-1) (lowest). PriorityTaskScheduler<N>, N = 3 by default.
+// - Within each band, we schedule FAIR by tenant (round-robin) using the same TenantRing
+//   as fair_scheduler.h. Task::priority is the band.
+// - Across bands, we schedule using budgets per cycle:
+//      budgets = { p0=70, p1=30, p2=1 }  (example)
+//   This prevents starvation: even if P0 is always busy, P1/P2 still get serviced.
+// - Band selection is branch-free: (occupied & budget-left) bitmask, then count-trailing-zeros.
+//
+// Notes:
+// - cancel() is eager: the task is unlinked from its lane in O(1) (intrusive_task_list.h),
+//   so empty() is exact and getNext() never wakes up for dead work.
+// - Tenant and task IDs are interned to 32-bit handles once at submit (id_interner.h);
+//   bands, lanes and cancel checks work on integers only.
+// - getNext() blocks until any band has work or shutdown() is called.
+// - submitAt/submitAfter park a task in a hierarchical timing wheel (timing_wheel.h);
+//   when due it joins its band like a fresh submit, and getNext() sleeps until the
+//   nearest deadline instead of polling.
+// - Retries (retry_policy.h): workers report complete(taskId) / fail(taskId). A failed task
+//   is resubmitted after a jittered backoff to the back of its tenant lane in its band;
+//   after maxAttempts runs it is dead-lettered.
+// - Rate limits (rate_limiter.h): setTenantRateLimit() gives a tenant one token bucket shared
+//   by all bands, charged Task::cost per task. A tenant that is out of tokens is parked off
+//   its band's ring until the refill time; a band whose tenants are all parked drops out
+//   of the eligible mask, so lower bands keep running meanwhile.
+// - Metrics (scheduler_metrics.h): per-thread counters (including budget resets) and wait
+//   histograms, read with metricsSnapshot() or metricsText() (per band/tenant depth too).
+// - Durability (task_log.h): attachLog() replays a write-ahead log into the bands, then
+//   logs submits, cancels and completions, so a restart keeps the backlog.
+// - Dependencies (dependency_graph.h): submit(task, deps) queues a task into its band once
+//   its deps have completed; submitGraph() takes a whole job graph and refuses cycles.
+// - Async consumers (coro_scheduler.h, C++20): `co_await sched.next(executor)` parks a
+//   coroutine instead of a thread.
+// - By default idle workers share one condition_variable for "any work arrived"
+//   (CondVarWait); pass SpinThenParkWait (wait_policy.h) as WaitPolicy to spin first.
+//
+// Deadline mode: DeadlineTaskScheduler<N, WaitPolicy> is Scheduler<DeadlineBands<N>, WaitPolicy>. Budgets bound a
+// low band's share, not its wait: with p2 = 1 and a P0 flood, a P2 task still waits for
+// whole cycles. DeadlineBands instead keeps every task in one indexed 4-ary heap
+// (indexed_heap.h) keyed by (band, deadline):
+// - Band first, then earliest deadline first. Task::deadline is absolute (deadlineAt());
+//   a task without one gets submit time + DeadlineOptions::slack[band].
+// - Aging: a task submitted to band b sits in band b - k once it has waited k * agingStep,
+//   and its deadline is tightened to at most (the time it got there) + slack[b - k]. Aging
+//   runs on pop and catches up on every step missed since: a task that waited three steps
+//   between two pops moves three bands at once, with the deadline it would have had.
+//   Promotion is a heap update, O(log n); so is cancel (heap erase).
+// - So a task submitted to band b reaches P0 within b * agingStep, and then runs before any
+//   P0 task submitted after it (with the same slack): its queueing delay is bounded by
+//   b * agingStep + slack[0] plus the service time of earlier-deadline work.
+// - Tasks are not grouped by tenant, so there are no tenant rate limits in this mode.
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <cstdint>
+#include <vector>
+#include <tuple>
+#include <array>
+#include <chrono>
+#include <algorithm>
+
+#include "id_interner.h"
+#include "indexed_heap.h"
+#include "intrusive_task_list.h"
+#include "scheduler_core.h"
+#include "task.h"
+#include "tenant_ring.h"
+
+// --------- Budgeted Priority Scheduler ---------
+// Per-cycle service budget for each band, highest priority first.
+template <std::size_t N = 3>
+struct Budgets
+{
+    std::array<int, N> perBand{};
+};
+
+// Budgets{70, 30, 1} deduces Budgets<3>.
+template <typename... Ts>
+Budgets(Ts...) -> Budgets<sizeof...(Ts)>;
+
+// 3 bands keep the original {70, 30, 1}; otherwise each band gets half the one above it.
+template <std::size_t N>
+Budgets<N> defaultBudgets()
+{
+    Budgets<N> b;
+    if constexpr (N == 3)
+    {
+        b.perBand = {70, 30, 1};
+    }
+    else
+    {
+        for (std::size_t i = 0; i < N; ++i)
+            b.perBand[i] = 1 << (N - 1 - i < 16 ? N - 1 - i : 16);
+    }
+    return b;
+}
+
+// QueuePolicy for Scheduler: N fair-by-tenant bands, P0 highest. Band choice is a bitmask
+// intersection plus one ctz:
+//   occupied_   : bit b set while band b has runnable tasks (queued, tenant not parked)
+//   budgetLeft_ : bit b set while band b has budget left in this cycle
+template <std::size_t N = 3>
+class PriorityBands
+{
+    static_assert(N >= 1 && N <= 64, "band masks are 64-bit");
+
+public:
+    using Nodes = TaskNodes<Task>;
+
+    static constexpr bool kTenants = true;
+    static constexpr const char* kName = "priority";
+
+    explicit PriorityBands(Budgets<N> b = defaultBudgets<N>()) : budgets_(b)
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (budgets_.perBand[i] > 0)
+                fundedMask_ |= bit(i);
+        }
+        budgetLeft_ = fundedMask_;
+    }
+
+    void normalize(Task& t) const
+    {
+        if (t.priority < 0) t.priority = 0;
+        if (static_cast<std::size_t>(t.priority) >= N) t.priority = static_cast<int>(N - 1);
+    }
+
+    void push(Nodes& nodes, TaskIdTable::Handle handle)
+    {
+        const std::size_t band = static_cast<std::size_t>(nodes[handle].task.priority);
+        bands_[band].push(nodes, handle);
+        occupied_ |= bit(band);
+    }
+
+    void unlink(Nodes& nodes, TaskIdTable::Handle handle)
+    {
+        const std::size_t band = static_cast<std::size_t>(nodes[handle].task.priority);
+        bands_[band].unlink(nodes, handle);
+        if (bands_[band].empty())
+            occupied_ &= ~bit(band);
+    }
+
+    // The core: budgeted selection across priority bands. Within a band: fair by tenant.
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> pop(Nodes& nodes, Admit& admit, SchedulerMetrics& metrics)
+    {
+        auto handle = popEligible(nodes, admit, metrics);
+
+        // If budgets block us but there is still work in some band, we reset and retry once.
+        // This prevents "dead budget" when a band is empty but its budget isn't consumed.
+        if (!handle && runnable())
+        {
+            resetCycle();
+            metrics.add(metrics::Counter::BudgetResets);
+            handle = popEligible(nodes, admit, metrics);
+        }
+        return handle;
+    }
+
+    void unpark(std::size_t band, IdInterner::Handle tenant)
+    {
+        bands_[band].unpark(tenant);
+        if (bands_[band].runnable())
+            occupied_ |= bit(band);
+    }
+
+    // Counts tasks of parked tenants too.
+    bool empty() const noexcept
+    {
+        for (const TenantRing& band : bands_)
+        {
+            if (!band.empty()) return false;
+        }
+        return true;
+    }
+
+    std::size_t size() const noexcept
+    {
+        std::size_t n = 0;
+        for (const TenantRing& band : bands_) n += band.size();
+        return n;
+    }
+
+    // Runnable work only: tasks of parked tenants don't count.
+    bool runnable() const noexcept { return occupied_ != 0; }
+
+    template <typename Fn>
+    void forEachLane(Fn&& fn) const
+    {
+        for (std::size_t b = 0; b < N; ++b)
+        {
+            bands_[b].forEachLane([&](IdInterner::Handle tenant, std::size_t n) {
+                fn(static_cast<int>(b), tenant, n);
+            });
+        }
+    }
+
+private:
+    static constexpr std::uint64_t bit(std::size_t band) { return std::uint64_t{1} << band; }
+
+    void resetCycle()
+    {
+        used_.fill(0);
+        budgetLeft_ = fundedMask_;
+    }
+
+    // Pops from `band` (must be occupied) and charges its budget. Returns nullopt, and
+    // clears the band's occupied_ bit, if every tenant left in it is throttled.
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> popFromBand(std::size_t band, Nodes& nodes, Admit& admit,
+                                                   SchedulerMetrics& metrics)
+    {
+        auto handle = bands_[band].popOne(
+            nodes, [&](IdInterner::Handle tenant, TaskIdTable::Handle h) { return admit(band, tenant, h); },
+            metrics);
+        if (bands_[band].empty() || !bands_[band].runnable())
+            occupied_ &= ~bit(band);
+        if (!handle) return std::nullopt;
+
+        if (++used_[band] >= budgets_.perBand[band])
+            budgetLeft_ &= ~bit(band);
+        return handle;
+    }
+
+    // Highest band that has both runnable work and budget left. A band whose tenants all
+    // turn out to be throttled drops out of occupied_, and the next band is tried.
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> popEligible(Nodes& nodes, Admit& admit, SchedulerMetrics& metrics)
+    {
+        while (std::uint64_t eligible = occupied_ & budgetLeft_)
+        {
+            if (auto handle = popFromBand(lowestSetBit(eligible), nodes, admit, metrics))
+                return handle;
+        }
+        return std::nullopt;
+    }
+
+    // N fair-by-tenant bands
+    std::array<TenantRing, N> bands_;
+
+    Budgets<N> budgets_;
+    std::array<int, N> used_{};
+    std::uint64_t fundedMask_ = 0; // bands with a positive budget
+    std::uint64_t budgetLeft_ = 0;
+    std::uint64_t occupied_ = 0;
+};
+
+template <std::size_t N = 3, typename WaitPolicy = CondVarWait>
+class PriorityTaskScheduler : public Scheduler<PriorityBands<N>, WaitPolicy>
+{
+    using Base = Scheduler<PriorityBands<N>, WaitPolicy>;
+
+public:
+    explicit PriorityTaskScheduler(Budgets<N> b = defaultBudgets<N>()) : Base(b) {}
+
+    // Reporting: (band, tenant, queued entries) for every non-empty lane.
+    std::vector<std::tuple<int, std::string, std::size_t>> pendingByTenant() const
+    {
+        auto lock = metrics::lockTimed(this->mtx_, this->metrics_);
+        std::vector<std::tuple<int, std::string, std::size_t>> out;
+        this->queue_.forEachLane([&](int band, IdInterner::Handle tenant, std::size_t n) {
+            out.emplace_back(band, this->tenants_.name(tenant), n);
+        });
+        return out;
+    }
+};
+
+// --------- Deadline (EDF) mode with aging ---------
+// Task::deadline for a point in time.
+inline std::uint64_t deadlineAt(std::chrono::steady_clock::time_point tp)
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count());
+}
+
+template <std::size_t N = 3>
+struct DeadlineOptions
+{
+    // Relative deadline per band for tasks submitted without one (Task::deadline == 0).
+    std::array<std::chrono::nanoseconds, N> slack{};
+    // Wait in a band before promotion to the next higher one; zero disables aging.
+    std::chrono::nanoseconds agingStep = std::chrono::milliseconds(100);
+};
+
+// P0 slack is 10ms; each lower band gets 10x the one above it (capped at 1000s).
+template <std::size_t N>
+DeadlineOptions<N> defaultDeadlineOptions()
+{
+    DeadlineOptions<N> o;
+    std::chrono::nanoseconds slack = std::chrono::milliseconds(10);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        o.slack[i] = slack;
+        if (slack < std::chrono::seconds(100)) slack *= 10;
+    }
+    return o;
+}
+
+// QueuePolicy for Scheduler: one indexed heap ordered by (band, deadline, submit order).
+// Every queued task is also on its band's list in the order it entered the band, so
+// aging only ever looks at list heads.
+template <std::size_t N = 3>
+class DeadlineBands
+{
+    static_assert(N >= 1, "at least one band");
+
+public:
+    using Nodes = TaskNodes<Task>;
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr bool kTenants = false;
+    static constexpr const char* kName = "deadline";
+
+    explicit DeadlineBands(DeadlineOptions<N> opts = defaultDeadlineOptions<N>()) : opts_(opts) {}
+
+    void normalize(Task& t) const
+    {
+        if (t.priority < 0) t.priority = 0;
+        if (static_cast<std::size_t>(t.priority) >= N) t.priority = static_cast<int>(N - 1);
+    }
+
+    // The effective deadline lives in the heap key; the task keeps the caller's, so a retry
+    // starts from a fresh default deadline.
+    void push(Nodes& nodes, TaskIdTable::Handle handle)
+    {
+        const Task& t = nodes[handle].task;
+        const std::uint32_t band = static_cast<std::uint32_t>(t.priority);
+        const std::uint64_t now = deadlineAt(Clock::now());
+        const std::uint64_t deadline = t.deadline ? t.deadline : now + slackNs(band);
+
+        if (handle >= submittedAt_.size()) submittedAt_.resize(handle + 1);
+        submittedAt_[handle] = now;
+        nodes[handle].lane = band;
+        lanes_[band][band].pushBack(nodes, handle);
+        heap_.push(handle, Key{band, deadline, seq_++});
+    }
+
+    void unlink(Nodes& nodes, TaskIdTable::Handle handle)
+    {
+        heap_.erase(handle);
+        laneOf(nodes, handle).unlink(nodes, handle);
+    }
+
+    // Ages overdue tasks up a band, then pops the earliest deadline of the highest band.
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> pop(Nodes& nodes, Admit&, SchedulerMetrics& metrics)
+    {
+        if (heap_.empty()) return std::nullopt;
+        if (opts_.agingStep.count() > 0 && N > 1)
+            ageUnlocked(nodes, metrics);
+
+        const TaskIdTable::Handle handle = heap_.pop();
+        laneOf(nodes, handle).unlink(nodes, handle);
+        return handle;
+    }
+
+    void unpark(std::size_t, IdInterner::Handle) {}
+
+    bool empty() const noexcept { return heap_.empty(); }
+    std::size_t size() const noexcept { return heap_.size(); }
+    bool runnable() const noexcept { return !heap_.empty(); }
+
+    // No tenants: one depth gauge per band (the band a task is in now, after aging).
+    template <typename Fn>
+    void forEachLane(Fn&& fn) const
+    {
+        for (std::size_t b = 0; b < N; ++b)
+        {
+            std::size_t depth = 0;
+            for (std::size_t origin = b; origin < N; ++origin) depth += lanes_[b][origin].size;
+            if (depth) fn(static_cast<int>(b), 0, depth);
+        }
+    }
+
+private:
+    struct Key
+    {
+        std::uint32_t band;
+        std::uint64_t deadline;
+        std::uint64_t seq; // FIFO among equal deadlines
+
+        bool operator<(const Key& o) const
+        {
+            if (band != o.band) return band < o.band;
+            if (deadline != o.deadline) return deadline < o.deadline;
+            return seq < o.seq;
+        }
+    };
+
+    std::uint64_t slackNs(std::size_t band) const { return static_cast<std::uint64_t>(opts_.slack[band].count()); }
+
+    // node.lane is the band the task is in now; Task::priority (normalized) the band it was
+    // submitted to.
+    IntrusiveList& laneOf(Nodes& nodes, TaskIdTable::Handle handle)
+    {
+        return lanes_[nodes[handle].lane][static_cast<std::size_t>(nodes[handle].task.priority)];
+    }
+
+    // Tasks are listed by (current band, submitted band). Tasks submitted to the same band
+    // reach each band in submit order, so every list is in submit order and only its head
+    // can be due: the head of lanes_[b][o] leaves band b at submit + (o - b + 1) * step.
+    // It goes straight to the band it belongs in now, behind tasks of its origin that got
+    // there earlier, which keeps that list in order too. Amortized O(log n) per promotion;
+    // the pop path checks N * (N - 1) / 2 heads.
+    void ageUnlocked(Nodes& nodes, SchedulerMetrics& metrics)
+    {
+        const std::uint64_t now = deadlineAt(Clock::now());
+        const std::uint64_t step = static_cast<std::uint64_t>(opts_.agingStep.count());
+
+        std::size_t promoted = 0;
+        for (std::size_t b = 1; b < N; ++b)
+        {
+            for (std::size_t origin = b; origin < N; ++origin)
+            {
+                IntrusiveList& lane = lanes_[b][origin];
+                while (!lane.empty())
+                {
+                    const TaskIdTable::Handle handle = lane.head;
+                    const std::uint64_t submitted = submittedAt_[handle];
+                    const std::uint64_t steps = (now - std::min(now, submitted)) / step;
+                    if (steps < origin - b + 1) break;
+
+                    const std::size_t target = origin - static_cast<std::size_t>(std::min<std::uint64_t>(steps, origin));
+                    const std::uint64_t arrived = submitted + (origin - target) * step;
+                    lane.unlink(nodes, handle);
+                    nodes[handle].lane = static_cast<std::uint32_t>(target);
+                    lanes_[target][origin].pushBack(nodes, handle);
+
+                    Key k = heap_.key(handle);
+                    k.band = static_cast<std::uint32_t>(target);
+                    k.deadline = std::min(k.deadline, arrived + slackNs(target));
+                    heap_.update(handle, k);
+                    promoted += b - target;
+                }
+            }
+        }
+        if (promoted) metrics.add(metrics::Counter::Promoted, promoted);
+    }
+
+    DeadlineOptions<N> opts_;
+    IndexedDaryHeap<Key> heap_;
+    std::array<std::array<IntrusiveList, N>, N> lanes_; // [current band][submitted band], submit order
+    std::vector<std::uint64_t> submittedAt_;           // indexed by task handle: push time
+    std::uint64_t seq_ = 0;
+};
+
+template <std::size_t N = 3, typename WaitPolicy = CondVarWait>
+using DeadlineTaskScheduler = Scheduler<DeadlineBands<N>, WaitPolicy>;
@@ -0,0 +1,72 @@
+// rate_limiter.h
+// C++17, STL only
+//
+// Per-tenant token buckets for the fair schedulers (setTenantRateLimit).
+//
+// - A bucket holds up to `burst` tokens and refills continuously at `perSecond`.
+//   Each dispatched task takes Task::cost tokens (1 where a scheduler has no cost).
+// - Refill is computed lazily from the elapsed time when the bucket is checked,
+//   so idle tenants cost nothing.
+// - A tenant whose bucket can't cover its head task is parked off the round-robin ring
+//   until readyAt (see the schedulers), so throttled tenants are never rescanned.
+// - Not thread-safe: callers guard it with their own lock.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+struct RateLimit
+{
+    double perSecond = 0; // <= 0: unlimited
+    double burst = 1;     // bucket size; also the most a tenant can run back to back
+};
+
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Starts full. Reconfiguring keeps the current tokens (capped to the new burst).
+    void configure(RateLimit limit, Clock::time_point now)
+    {
+        const bool wasLimited = limited();
+        rate_ = limit.perSecond > 0 ? limit.perSecond : 0;
+        burst_ = std::max(limit.burst, 1.0);
+        tokens_ = wasLimited ? std::min(tokens_, burst_) : burst_;
+        last_ = now;
+    }
+
+    bool limited() const noexcept { return rate_ > 0; }
+
+    // Takes `cost` tokens if the bucket has them. Otherwise takes nothing and sets
+    // `readyAt` to when it will. A cost above the burst is charged as a full bucket.
+    bool tryTake(double cost, Clock::time_point now, Clock::time_point& readyAt)
+    {
+        const double need = std::min(cost, burst_);
+        refill(now);
+        if (tokens_ >= need)
+        {
+            tokens_ -= need;
+            return true;
+        }
+
+        const std::chrono::duration<double> wait((need - tokens_) / rate_);
+        readyAt = now + std::chrono::ceil<Clock::duration>(wait);
+        return false;
+    }
+
+private:
+    void refill(Clock::time_point now)
+    {
+        if (now <= last_) return;
+        const std::chrono::duration<double> elapsed = now - last_;
+        tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+        last_ = now;
+    }
+
+    double rate_ = 0;
+    double burst_ = 1;
+    double tokens_ = 1;
+    Clock::time_point last_{};
+};
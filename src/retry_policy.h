@@ -0,0 +1,176 @@
+// retry_policy.h
+// C++17, STL only
+//
+// Worker-reported outcomes for dispatched tasks: complete(taskId) / fail(taskId).
+//
+// - RetryPolicy  : attempt limit plus exponential backoff with full jitter
+//                  (retry k waits a uniform draw from [0, min(maxDelay, baseDelay * 2^(k-1))]),
+//                  so retries of tasks that failed together spread out instead of
+//                  hitting a stalled downstream in lockstep.
+// - RetryTracker : remembers every dispatched task until the worker reports on it.
+//                  fail() hands back the task with its attempt counter bumped and the
+//                  delay to resubmit it with, or moves it to the dead-letter queue once
+//                  the attempt limit is reached.
+//
+// Tracking is off until a policy with maxAttempts > 0 is installed; until then the
+// dispatch path only pays one relaxed atomic load. Thread-safe: own mutex, taken after
+// (never around) the scheduler's lock.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "id_interner.h"
+
+struct RetryPolicy
+{
+    std::uint32_t maxAttempts = 0; // total runs per task, first one included; 0 = no tracking
+    std::chrono::milliseconds baseDelay{10};
+    std::chrono::milliseconds maxDelay{10000};
+};
+
+enum class TaskStatus
+{
+    Succeeded,
+    Failed,
+};
+
+template <typename TaskT>
+class RetryTracker
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Retry
+    {
+        TaskT task; // attempt already incremented
+        Clock::duration delay;
+    };
+
+    enum class Outcome
+    {
+        Unknown,    // not in flight (never dispatched, already reported, or tracking off)
+        Retry,      // resubmit `retry` after its delay
+        DeadLetter, // attempt limit reached; parked in the dead-letter queue
+    };
+
+    void setPolicy(RetryPolicy policy)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        policy_ = policy;
+        enabled_.store(policy.maxAttempts > 0, std::memory_order_relaxed);
+        if (!policy_.maxAttempts)
+            inFlight_.clear();
+    }
+
+    // True while a policy is installed: then every dispatched task is tracked, and a report
+    // on an untracked ID is one on a task that isn't in flight.
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Dispatch hook: records the task (if tracking) and passes it through.
+    std::optional<TaskT> track(std::optional<TaskT> t)
+    {
+        if (t && enabled_.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            inFlight_.insert_or_assign(t->task_id, *t); // a duplicate in-flight ID keeps the newest
+        }
+        return t;
+    }
+
+    // Batch form: records the last `n` tasks of `out` under one lock; returns n.
+    std::size_t trackTail(const std::vector<TaskT>& out, std::size_t n)
+    {
+        if (n && enabled_.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (std::size_t i = out.size() - n; i < out.size(); ++i)
+                inFlight_.insert_or_assign(out[i].task_id, out[i]);
+        }
+        return n;
+    }
+
+    bool complete(const std::string& taskId)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return inFlight_.erase(taskId) > 0;
+    }
+
+    Outcome fail(const std::string& taskId, std::optional<Retry>& retry)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = inFlight_.find(taskId);
+        if (it == inFlight_.end()) return Outcome::Unknown;
+
+        TaskT t = std::move(it->second);
+        inFlight_.erase(it);
+        ++t.attempt;
+
+        if (t.attempt >= policy_.maxAttempts)
+        {
+            deadLetters_.push_back(std::move(t));
+            return Outcome::DeadLetter;
+        }
+
+        const Clock::duration delay = backoffUnlocked(t.attempt);
+        retry.emplace(Retry{std::move(t), delay});
+        return Outcome::Retry;
+    }
+
+    // For a retry the scheduler could not take back (shutdown).
+    void deadLetter(TaskT t)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        deadLetters_.push_back(std::move(t));
+    }
+
+    std::vector<TaskT> drainDeadLetters()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<TaskT> out;
+        out.swap(deadLetters_);
+        return out;
+    }
+
+    std::size_t deadLetterSize() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return deadLetters_.size();
+    }
+
+    std::size_t inFlightSize() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return inFlight_.size();
+    }
+
+private:
+    // Full jitter over the capped exponential window for the given (1-based) retry.
+    Clock::duration backoffUnlocked(std::uint32_t attempt)
+    {
+        using Ms = std::chrono::milliseconds;
+        const std::uint32_t shift = std::min<std::uint32_t>(attempt - 1, 30);
+        const Ms::rep base = std::max<Ms::rep>(policy_.baseDelay.count(), 0);
+        const Ms::rep cap = std::min<Ms::rep>(policy_.maxDelay.count(), base << shift);
+        if (cap <= 0) return Clock::duration::zero();
+
+        std::uniform_int_distribution<Ms::rep> pick(0, cap);
+        return Ms(pick(rng_));
+    }
+
+    mutable std::mutex mtx_;
+    std::atomic<bool> enabled_{false};
+    RetryPolicy policy_;
+    SlabHashMap<std::string, TaskT> inFlight_;
+    std::vector<TaskT> deadLetters_;
+    std::minstd_rand rng_{std::random_device{}()};
+};
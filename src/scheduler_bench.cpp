@@ -0,0 +1,355 @@
+// scheduler_bench.cpp
+// C++17, STL only
+//
+// Throughput / latency benchmark for the FIFO, fair, priority and deadline schedulers.
+//
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread src/scheduler_bench.cpp -o scheduler_bench
+//   ./scheduler_bench [--tasks N] [--task-ns NS] [--scheduler NAME] [--quick] > results.json
+//
+// Sweeps scheduler variant x producers x consumers x tenants x cancel ratio x band mix.
+// The "-spin" variants are the same schedulers with SpinThenParkWait (wait_policy.h)
+// instead of CondVarWait.
+// Each run:
+// - Producers submit pre-built tasks (ID strings are made before the clock starts) and
+//   cancel a share of their own tasks a few submissions later, while they may still be queued.
+// - Consumers drain with getNext(); enqueue-to-dequeue latency comes from Task::ts, which
+//   carries the steady_clock time of submit. With --task-ns, each consumer then busy-waits
+//   that long per task to model real work (wake-up costs matter most for short tasks).
+// - The run ends when producers are done, the scheduler is empty and every consumer has
+//   finished its last task.
+// Output is one JSON document on stdout: build flags plus one object per run with ops/sec
+// (dequeued tasks per wall-clock second) and p50/p99/p999/max latency in nanoseconds.
+// Build with -DSCHED_NO_SLAB to A/B the slab allocator.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fair_scheduler.h"
+#include "fifo_scheduler.h"
+#include "priority_scheduler.h"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+std::uint64_t nowNs()
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+enum class BandMix
+{
+    Uniform, // P0/P1/P2 in equal parts
+    Skewed,  // 80% P0, 15% P1, 5% P2
+};
+
+const char* bandMixName(BandMix m)
+{
+    return m == BandMix::Uniform ? "uniform" : "skewed";
+}
+
+int bandFor(BandMix mix, std::size_t i)
+{
+    if (mix == BandMix::Uniform) return static_cast<int>(i % 3);
+    const std::size_t r = i % 20;
+    return r < 16 ? 0 : (r < 19 ? 1 : 2);
+}
+
+struct RunConfig
+{
+    std::string scheduler;
+    std::size_t producers = 1;
+    std::size_t consumers = 1;
+    std::size_t tenants = 1;
+    double cancelRatio = 0;
+    BandMix mix = BandMix::Uniform;
+    std::size_t tasks = 0;
+    std::uint64_t taskNs = 0;
+};
+
+struct RunResult
+{
+    std::size_t dequeued = 0;
+    std::size_t canceled = 0;
+    double seconds = 0;
+    std::uint64_t p50 = 0, p99 = 0, p999 = 0, max = 0;
+};
+
+// FIFO and deadline ignore the tenant; only priority and deadline use the band.
+void fillTask(Task& t, std::string id, std::size_t tenant, int band)
+{
+    t.task_id = std::move(id);
+    t.tenant_id = "tenant-" + std::to_string(tenant);
+    t.priority = band;
+}
+
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double q)
+{
+    if (sorted.empty()) return 0;
+    const std::size_t idx = std::min(sorted.size() - 1, static_cast<std::size_t>(q * sorted.size()));
+    return sorted[idx];
+}
+
+template <typename Sched>
+RunResult runOne(Sched& sched, const RunConfig& cfg)
+{
+    constexpr std::size_t kCancelLag = 16; // cancel a task this many submissions after it
+
+    // Pre-build every producer's tasks so the timed section measures the scheduler only.
+    const std::size_t perProducer = cfg.tasks / cfg.producers;
+    std::vector<std::vector<Task>> work(cfg.producers);
+    for (std::size_t p = 0; p < cfg.producers; ++p)
+    {
+        work[p].resize(perProducer);
+        for (std::size_t i = 0; i < perProducer; ++i)
+        {
+            const std::size_t global = p * perProducer + i;
+            fillTask(work[p][i], "p" + std::to_string(p) + "-" + std::to_string(i),
+                     global % cfg.tenants, bandFor(cfg.mix, global));
+        }
+    }
+
+    const std::size_t cancelEvery =
+        cfg.cancelRatio > 0 ? std::max<std::size_t>(1, static_cast<std::size_t>(1.0 / cfg.cancelRatio)) : 0;
+
+    std::atomic<std::size_t> canceled{0};
+    std::atomic<bool> go{false};
+    std::vector<std::vector<std::uint64_t>> latencies(cfg.consumers);
+
+    std::vector<std::thread> consumers;
+    for (std::size_t c = 0; c < cfg.consumers; ++c)
+    {
+        latencies[c].reserve(cfg.tasks / cfg.consumers + 1024);
+        consumers.emplace_back([&, c] {
+            while (auto t = sched.getNext())
+            {
+                const std::uint64_t dequeued = nowNs();
+                latencies[c].push_back(dequeued - t->ts);
+                while (cfg.taskNs && nowNs() - dequeued < cfg.taskNs) {}
+            }
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (std::size_t p = 0; p < cfg.producers; ++p)
+    {
+        producers.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            std::vector<Task>& mine = work[p];
+            std::vector<std::string> ids;
+            if (cancelEvery) ids.reserve(mine.size());
+
+            std::size_t localCanceled = 0;
+            for (std::size_t i = 0; i < mine.size(); ++i)
+            {
+                if (cancelEvery) ids.push_back(mine[i].task_id);
+                mine[i].ts = nowNs();
+                sched.submit(std::move(mine[i]));
+
+                if (cancelEvery && i >= kCancelLag && (i - kCancelLag) % cancelEvery == 0)
+                    localCanceled += sched.cancel(ids[i - kCancelLag]) ? 1 : 0;
+            }
+            canceled.fetch_add(localCanceled, std::memory_order_relaxed);
+        });
+    }
+
+    const auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& th : producers) th.join();
+
+    // Once the queue is empty, shutdown lets consumers finish the task in hand and exit; the
+    // clock stops when the last one has, so --task-ns work is counted in full.
+    while (!sched.empty())
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    sched.shutdown();
+    for (auto& th : consumers) th.join();
+    const auto end = Clock::now();
+
+    std::vector<std::uint64_t> all;
+    for (auto& v : latencies) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+
+    RunResult r;
+    r.dequeued = all.size();
+    r.canceled = canceled.load();
+    r.seconds = std::chrono::duration<double>(end - start).count();
+    r.p50 = percentile(all, 0.50);
+    r.p99 = percentile(all, 0.99);
+    r.p999 = percentile(all, 0.999);
+    r.max = all.empty() ? 0 : all.back();
+    return r;
+}
+
+RunResult runScheduler(const RunConfig& cfg)
+{
+    const bool spin = cfg.scheduler.size() > 5 && cfg.scheduler.compare(cfg.scheduler.size() - 5, 5, "-spin") == 0;
+    const std::string base = spin ? cfg.scheduler.substr(0, cfg.scheduler.size() - 5) : cfg.scheduler;
+
+    if (base == "fifo-single" && spin)
+    {
+        Scheduler<FifoQueue, SpinThenParkWait> sched;
+        return runOne(sched, cfg);
+    }
+    if (base.rfind("fifo-", 0) == 0)
+    {
+        FifoOptions opts;
+        if (base == "fifo-stealing") opts.backend = FifoBackend::WorkStealing;
+        if (base == "fifo-ring") opts.backend = FifoBackend::Ring;
+        FifoTaskScheduler sched(opts);
+        return runOne(sched, cfg);
+    }
+    if (base.rfind("fair-", 0) == 0)
+    {
+        FairOptions opts;
+        if (base == "fair-drr") opts.mode = FairMode::DeficitRoundRobin;
+        if (spin)
+        {
+            FairTaskScheduler<SpinThenParkWait> sched(opts);
+            return runOne(sched, cfg);
+        }
+        FairTaskScheduler<> sched(opts);
+        return runOne(sched, cfg);
+    }
+    if (base == "deadline")
+    {
+        if (spin)
+        {
+            DeadlineTaskScheduler<3, SpinThenParkWait> sched;
+            return runOne(sched, cfg);
+        }
+        DeadlineTaskScheduler<> sched;
+        return runOne(sched, cfg);
+    }
+    if (spin)
+    {
+        PriorityTaskScheduler<3, SpinThenParkWait> sched;
+        return runOne(sched, cfg);
+    }
+    PriorityTaskScheduler<> sched;
+    return runOne(sched, cfg);
+}
+
+void printRun(const RunConfig& cfg, const RunResult& r, bool first)
+{
+    const double ops = r.seconds > 0 ? r.dequeued / r.seconds : 0;
+    std::cout << (first ? "" : ",\n")
+              << "    {\"scheduler\": \"" << cfg.scheduler << "\""
+              << ", \"producers\": " << cfg.producers
+              << ", \"consumers\": " << cfg.consumers
+              << ", \"tenants\": " << cfg.tenants
+              << ", \"cancel_ratio\": " << cfg.cancelRatio
+              << ", \"band_mix\": \"" << bandMixName(cfg.mix) << "\""
+              << ", \"tasks\": " << cfg.tasks
+              << ", \"task_ns\": " << cfg.taskNs
+              << ", \"dequeued\": " << r.dequeued
+              << ", \"canceled\": " << r.canceled
+              << ", \"seconds\": " << r.seconds
+              << ", \"ops_per_sec\": " << static_cast<std::uint64_t>(ops)
+              << ", \"latency_ns\": {\"p50\": " << r.p50
+              << ", \"p99\": " << r.p99
+              << ", \"p999\": " << r.p999
+              << ", \"max\": " << r.max << "}}";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t tasks = 100000;
+    std::uint64_t taskNs = 0;
+    std::string only;
+    bool quick = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--tasks") && i + 1 < argc) tasks = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--task-ns") && i + 1 < argc) taskNs = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--scheduler") && i + 1 < argc) only = argv[++i];
+        else if (!std::strcmp(argv[i], "--quick")) quick = true;
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--tasks N] [--task-ns NS] [--scheduler NAME] [--quick]\n";
+            return 2;
+        }
+    }
+
+    const std::vector<std::string> schedulers = {
+        "fifo-single", "fifo-single-spin", "fifo-stealing", "fifo-ring", "fair-rr",
+        "fair-rr-spin", "fair-drr", "fair-drr-spin", "priority", "priority-spin",
+        "deadline", "deadline-spin"};
+    if (!only.empty() && std::find(schedulers.begin(), schedulers.end(), only) == schedulers.end())
+    {
+        std::cerr << "unknown scheduler '" << only << "'; one of:";
+        for (const std::string& name : schedulers) std::cerr << ' ' << name;
+        std::cerr << "\nusage: " << argv[0] << " [--tasks N] [--task-ns NS] [--scheduler NAME] [--quick]\n";
+        return 2;
+    }
+
+    const std::vector<std::size_t> threadCounts = quick ? std::vector<std::size_t>{1, 4}
+                                                        : std::vector<std::size_t>{1, 2, 4, 8};
+    const std::vector<std::size_t> tenantCounts = quick ? std::vector<std::size_t>{1, 64}
+                                                        : std::vector<std::size_t>{1, 8, 64};
+    const std::vector<double> cancelRatios = {0.0, 0.1};
+
+#ifdef SCHED_NO_SLAB
+    const bool slab = false;
+#else
+    const bool slab = true;
+#endif
+#ifdef NDEBUG
+    const bool ndebug = true;
+#else
+    const bool ndebug = false;
+#endif
+
+    std::cout << "{\n  \"build\": {\"slab\": " << (slab ? "true" : "false")
+              << ", \"ndebug\": " << (ndebug ? "true" : "false")
+              << ", \"hardware_threads\": " << std::thread::hardware_concurrency() << "},\n"
+              << "  \"results\": [\n";
+
+    bool first = true;
+    for (const std::string& name : schedulers)
+    {
+        if (!only.empty() && name != only) continue;
+
+        const bool tenantless = name.rfind("fifo-", 0) == 0 || name.rfind("deadline", 0) == 0;
+        const bool priority = name.rfind("priority", 0) == 0 || name.rfind("deadline", 0) == 0;
+        for (std::size_t producers : threadCounts)
+        {
+            for (std::size_t consumers : threadCounts)
+            {
+                // FIFO and deadline have no tenants: one tenant count. Only banded ones sweep mixes.
+                for (std::size_t tenants : tenantless ? std::vector<std::size_t>{1} : tenantCounts)
+                {
+                    for (double cancelRatio : cancelRatios)
+                    {
+                        for (BandMix mix : priority ? std::vector<BandMix>{BandMix::Uniform, BandMix::Skewed}
+                                                    : std::vector<BandMix>{BandMix::Uniform})
+                        {
+                            RunConfig cfg{name, producers, consumers, tenants, cancelRatio, mix, tasks};
+                            cfg.tasks = tasks / producers * producers;
+                            cfg.taskNs = taskNs;
+                            printRun(cfg, runScheduler(cfg), first);
+                            first = false;
+                            std::cout.flush();
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << "\n  ]\n}\n";
+    return 0;
+}
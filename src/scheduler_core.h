@@ -0,0 +1,927 @@
+// scheduler_core.h
+// C++17, STL only
+//
+// Scheduler<QueuePolicy, WaitPolicy, CancelPolicy>: everything the mutex-based schedulers
+// share (lock, blocking wait, shutdown, eager cancel, delayed tasks, retries, rate limits,
+// metrics) around a pluggable ordering. Policies are plain classes picked at compile
+// time, so calls into them inline and nothing on the submit/pop paths is virtual.
+//
+// QueuePolicy decides the order. Tasks live in the core's node pool (intrusive_task_list.h),
+// indexed by task handle; the policy links them into its own lanes:
+//   FifoQueue (fifo_scheduler.h), FairQueue (fair_scheduler.h), PriorityBands<N> (priority_scheduler.h)
+// It provides:
+//   static constexpr bool kTenants;           // intern Task::tenant_id (lane = tenant handle)
+//   static constexpr const char* kName;       // metrics label
+//   void normalize(Task&) const;              // before the task is stored
+//   void push(Nodes&, Handle);                // link a stored task (submit, timer release)
+//   void unlink(Nodes&, Handle);              // cancel; O(1)
+//   std::optional<Handle> pop(Nodes&, Admit&, SchedulerMetrics&);
+//   void unpark(std::size_t band, IdInterner::Handle tenant);
+//   bool empty() const;  std::size_t size() const;
+//   bool runnable() const;                    // work not held back by parked tenants
+//   void forEachLane(Fn) const;               // fn(int band or -1, tenant handle, depth)
+// pop() asks admit(band, tenant, handle) before taking a tenant's head task; on false the
+// tenant is out of rate-limit tokens and the policy keeps it parked in `band` until the
+// core calls unpark() (band is 0 for policies without bands).
+//
+// WaitPolicy decides how idle workers sleep and are woken (wait_policy.h):
+//   CondVarWait      : one shared condition variable (default).
+//   SpinThenParkWait : spin with the lock released, then park per worker; wakes only as
+//                      many workers as there is new work.
+//
+// CancelPolicy decides whether task IDs are indexed:
+//   EagerCancel : submit hashes the ID once; cancel(taskId) unlinks in O(1) (default).
+//   NoCancel    : no ID index, so submit never hashes a string; cancel() does not compile.
+//
+// Durability is opt-in: attachLog() replays a TaskLog (task_log.h, the only POSIX header;
+// this one sees it through durable_log.h) into the scheduler, after which submits and
+// cancels return once their record is on disk (group commit), and complete()/fail() log
+// the task's end. Records are appended under mtx_, so the log order is the queue order;
+// the fsync wait happens after mtx_ is released. If the log fails, submits and cancels
+// still take effect in memory but return false (0 for submitBatch) and count not_durable.
+//
+// Dependencies (dependency_graph.h): submit(task, deps) and submitGraph() hold a task back,
+// stored but unlinked, until each of its deps has been reported with complete(); the last
+// one queues it. Canceled or dead-lettered deps drop their dependents. Blocked tasks are
+// logged when released, so a crash loses them rather than running them early.
+//
+// Async consumers (coro_scheduler.h, C++20): `co_await sched.next(executor)` parks a
+// TaskWaiter instead of a thread. Submits hand new work straight to parked waiters, oldest
+// first, and post them to their executor; only work left over wakes blocked getNext()
+// callers. Delayed tasks and tenant refills reach waiters through pollAsync(), which the
+// executor calls when nextWake says so or when the wake hook reports a new, earlier deadline.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "dependency_graph.h"
+#include "durable_log.h"
+#include "id_interner.h"
+#include "intrusive_task_list.h"
+#include "rate_limiter.h"
+#include "retry_policy.h"
+#include "scheduler_metrics.h"
+#include "task.h"
+#include "timing_wheel.h"
+#include "wait_policy.h"
+
+inline unsigned lowestSetBit(std::uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned i = 0;
+    while (!(mask & 1)) { mask >>= 1; ++i; }
+    return i;
+#endif
+}
+
+// --------- Cancel policies ---------
+struct EagerCancel
+{
+    static constexpr bool kEnabled = true;
+};
+
+struct NoCancel
+{
+    static constexpr bool kEnabled = false;
+};
+
+// --------- Async consumers ---------
+// A consumer parked in the scheduler without a thread. The scheduler fills `task` (nullopt
+// on shutdown), unlinks the waiter and calls resume(this) once, after releasing its lock.
+struct TaskWaiter
+{
+    std::optional<Task> task;
+    void (*resume)(TaskWaiter*) = nullptr;
+    TaskWaiter* next = nullptr;
+};
+
+// Awaitable returned by next(executor); defined in coro_scheduler.h.
+template <typename Source, typename Executor>
+class NextAwaiter;
+
+// --------- Core ---------
+template <typename QueuePolicy, typename WaitPolicy = CondVarWait, typename CancelPolicy = EagerCancel>
+class Scheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Nodes = TaskNodes<Task>;
+
+    // Arguments go to the QueuePolicy constructor.
+    template <typename... Args>
+    explicit Scheduler(Args&&... args) : queue_(std::forward<Args>(args)...)
+    {
+    }
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    bool submit(Task t)
+    {
+        std::uint64_t lsn = 0;
+        TaskWaiter* served = nullptr;
+        OwedWakes owed;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            if (shutdown_) return false;
+
+            if (log_) lsn = log_->logSubmit(t);
+            queue_.push(nodes_, admitUnlocked(std::move(t)));
+            served = handOffUnlocked();
+            owed = takeWakesUnlocked();
+        }
+        metrics_.add(metrics::Counter::Submitted);
+        if (served) resumeWaiters(served);
+        else wait_.notifyOne();
+        payWakes(owed);
+        return waitDurable(lsn);
+    }
+
+    // Holds the task until `due`, then queues it like submit(). Returns false if shutdown
+    // (or, as for submit(), if the log failed to persist it).
+    bool submitAt(Task t, Clock::time_point due)
+    {
+        std::uint64_t lsn = 0;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            if (shutdown_) return false;
+
+            if (log_) lsn = log_->logSubmit(t, due);
+            const TaskIdTable::Handle handle = admitUnlocked(std::move(t));
+            timers_.schedule(TimerRef{handle, taskIds_.generation(handle)}, due);
+            ++delayed_;
+            wakeAsyncIfEarlierUnlocked(); // so does the executor polling for async waiters
+        }
+        metrics_.add(metrics::Counter::Submitted);
+        // A sleeping worker may be waiting on a later deadline; let one re-arm.
+        wait_.notifyOne();
+        return waitDurable(lsn);
+    }
+
+    template <typename Rep, typename Period>
+    bool submitAfter(Task t, std::chrono::duration<Rep, Period> delay)
+    {
+        return submitAt(std::move(t), Clock::now() + delay);
+    }
+
+    // Batch submit: tasks are moved from; one lock acquisition for the whole batch and
+    // at most `count` idle workers woken. Returns how many were accepted: 0 if shutdown,
+    // and 0 too if the log failed to persist the batch (queued all the same, see above).
+    std::size_t submitBatch(Task* tasks, std::size_t count)
+    {
+        std::size_t idle = 0, handed = 0;
+        std::uint64_t lsn = 0;
+        TaskWaiter* served = nullptr;
+        OwedWakes owed;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            if (shutdown_) return 0;
+
+            if (log_) lsn = log_->logSubmitBatch(tasks, count);
+            for (std::size_t i = 0; i < count; ++i)
+                queue_.push(nodes_, admitUnlocked(std::move(tasks[i])));
+            served = handOffUnlocked(&handed);
+            idle = waiters_;
+            owed = takeWakesUnlocked();
+        }
+        metrics_.add(metrics::Counter::Submitted, count);
+        resumeWaiters(served);
+        if (handed < count) wait_.notifyUpTo(count - handed, idle);
+        payWakes(owed);
+        return waitDurable(lsn) ? count : 0;
+    }
+
+    // Queues `t` once every task in `deps` has completed (complete() reported success).
+    // Only tasks submitted with deps (here or via submitGraph) and not completed yet are
+    // waited for; any other dep counts as done. Returns false if shutdown, or if `t`'s ID
+    // is still in the dependency graph or lists itself.
+    bool submit(Task t, const std::vector<std::string>& deps)
+    {
+        std::uint64_t lsn = 0;
+        TaskWaiter* served = nullptr;
+        OwedWakes owed;
+        bool ready = false;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            if (shutdown_ || !graph_.accepts(t.task_id, deps)) return false;
+
+            hasGraph_.store(true, std::memory_order_relaxed);
+            const TaskIdTable::Handle handle = admitUnlocked(std::move(t));
+            ready = graph_.add(nodes_[handle].task.task_id, deps, handle);
+            if (ready)
+            {
+                lsn = queueReleasedUnlocked(handle);
+                served = handOffUnlocked();
+                owed = takeWakesUnlocked();
+            }
+        }
+        metrics_.add(metrics::Counter::Submitted);
+        if (served) resumeWaiters(served);
+        else if (ready) wait_.notifyOne();
+        payWakes(owed);
+        return waitDurable(lsn);
+    }
+
+    // A whole job graph at once: deps may name tasks anywhere in `tasks`, in any order.
+    // Tasks are moved from. All or nothing: returns false (nothing submitted) if shutdown,
+    // an ID repeats or is still in the graph, or the deps within the batch form a cycle.
+    bool submitGraph(std::vector<DependentTask>& tasks)
+    {
+        std::size_t ready = 0, handed = 0, idle = 0;
+        std::uint64_t lsn = 0;
+        TaskWaiter* served = nullptr;
+        OwedWakes owed;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            std::vector<std::size_t> order;
+            if (shutdown_ || !graph_.checkBatch(tasks, order)) return false;
+
+            hasGraph_.store(true, std::memory_order_relaxed);
+            for (std::size_t i : order)
+            {
+                const TaskIdTable::Handle handle = admitUnlocked(std::move(tasks[i].task));
+                if (!graph_.add(nodes_[handle].task.task_id, tasks[i].deps, handle)) continue;
+                lsn = std::max(lsn, queueReleasedUnlocked(handle));
+                ++ready;
+            }
+            served = handOffUnlocked(&handed);
+            idle = waiters_;
+            owed = takeWakesUnlocked();
+        }
+        metrics_.add(metrics::Counter::Submitted, tasks.size());
+        resumeWaiters(served);
+        if (handed < ready) wait_.notifyUpTo(ready - handed, idle);
+        payWakes(owed);
+        return waitDurable(lsn);
+    }
+
+    // Eager cancel: unlinks the queued task in O(1). A delayed task is dropped too; its
+    // timer entry goes stale and is ignored when it fires. So is a task blocked on deps,
+    // and so are the blocked tasks that depend on the canceled one.
+    // Returns false if no such task is queued, delayed or blocked, or if the log failed to
+    // persist the cancel (the task is gone from memory, but may come back on restart).
+    bool cancel(const std::string& taskId)
+    {
+        static_assert(CancelPolicy::kEnabled, "cancel() needs EagerCancel");
+
+        std::uint64_t lsn = 0;
+        std::size_t dropped = 0;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            auto handle = taskIds_.findLive(taskId);
+            if (!handle) return false;
+
+            const bool blocked = graph_.isBlocked(taskId);
+            if (nodes_[*handle].linked) queue_.unlink(nodes_, *handle);
+            else if (!blocked) --delayed_;
+
+            nodes_[*handle].task = Task{}; // drop the payload now, not when the slot is reused
+            taskIds_.release(*handle);
+            dropped = dropDependentsUnlocked(taskId);
+            if (log_ && !blocked) lsn = log_->logCancel(taskId); // blocked tasks aren't logged yet
+        }
+        metrics_.add(metrics::Counter::Canceled);
+        metrics_.add(metrics::Counter::DepsDropped, dropped);
+        // A canceled task must not come back on restart.
+        return waitDurable(lsn);
+    }
+
+    std::optional<Task> tryGetNext()
+    {
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+        if (shutdown_) return std::nullopt;
+        releaseDueUnlocked();
+        releaseThrottledUnlocked();
+        std::optional<Task> t = retries_.track(popOneUnlocked());
+        unlockAndWake(lock);
+        return t;
+    }
+
+    // Blocks until a task is available or shutdown() is called. The thread-free variant
+    // is next() below.
+    std::optional<Task> getNext()
+    {
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+
+        for (;;)
+        {
+            waitForWorkUnlocked(lock);
+            if (shutdown_) return std::nullopt;
+
+            if (auto t = popOneUnlocked())
+            {
+                t = retries_.track(std::move(t));
+                unlockAndWake(lock);
+                return t;
+            }
+
+            // Runnable work existed but was held back: its tenants just got throttled, or
+            // the policy declined it (e.g. a band with a zero budget).
+        }
+    }
+
+    // Blocking batch dequeue: waits for at least one task, then appends up to `max` tasks
+    // to `out` under one lock. Each task is picked exactly as by getNext(), so fairness,
+    // budgets and rate limits are charged the same. Returns the number appended (0 on shutdown).
+    std::size_t getNextBatch(std::size_t max, std::vector<Task>& out)
+    {
+        if (max == 0) return 0;
+
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+
+        for (;;)
+        {
+            waitForWorkUnlocked(lock);
+            if (shutdown_) return 0;
+
+            std::size_t got = 0;
+            for (; got < max; ++got)
+            {
+                auto t = popOneUnlocked();
+                if (!t) break;
+                out.push_back(std::move(*t));
+            }
+            if (got > 0)
+            {
+                got = retries_.trackTail(out, got);
+                unlockAndWake(lock);
+                return got;
+            }
+        }
+    }
+
+    void shutdown()
+    {
+        TaskWaiter* parked = nullptr;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            shutdown_ = true;
+            parked = std::exchange(asyncHead_, nullptr); // their task stays nullopt
+            asyncTail_ = nullptr;
+        }
+        wait_.notifyAll();
+        resumeWaiters(parked);
+    }
+
+    // Awaitable getNext() for C++20 coroutines (coro_scheduler.h): `co_await next(ex)`
+    // yields the next task, or nullopt on shutdown. A coroutine with nothing to do is parked
+    // here without a thread, and is resumed on `ex` (anything with post(coroutine_handle<>))
+    // by whichever submit brings its task.
+    template <typename Executor>
+    NextAwaiter<Scheduler, Executor> next(Executor& ex)
+    {
+        return NextAwaiter<Scheduler, Executor>(*this, ex);
+    }
+
+    // Takes a task for `w` now and returns true (w.task is nullopt on shutdown), or parks `w`
+    // until a submit or pollAsync() serves it and returns false.
+    bool getNextAsync(TaskWaiter& w)
+    {
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+        if (shutdown_) return true;
+        releaseDueUnlocked();
+        releaseThrottledUnlocked();
+        if (auto t = popOneUnlocked())
+        {
+            w.task = retries_.track(std::move(t));
+            unlockAndWake(lock);
+            return true;
+        }
+
+        w.next = nullptr;
+        if (asyncTail_) asyncTail_->next = &w;
+        else asyncHead_ = &w;
+        asyncTail_ = &w;
+        wakeAsyncIfEarlierUnlocked(); // a due time or refill the executor doesn't know about yet
+        unlockAndWake(lock);
+        return false;
+    }
+
+    // Releases due delayed tasks and refilled tenants to parked waiters. Returns when it
+    // should run again: the earliest pending deadline, if any.
+    std::optional<Clock::time_point> pollAsync()
+    {
+        std::optional<Clock::time_point> wake;
+        TaskWaiter* served = nullptr;
+        OwedWakes owed;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            releaseDueUnlocked();
+            releaseThrottledUnlocked();
+            served = handOffUnlocked();
+            wake = nextWakeUnlocked();
+            asyncPollAt_ = wake;
+            owed = takeWakesUnlocked();
+        }
+        resumeWaiters(served);
+        payWakes(owed);
+        return wake;
+    }
+
+    // Called when a deadline may now be earlier than the last pollAsync() result: the
+    // executor should poll again soon. Runs under the scheduler lock, so it must not call
+    // back into the scheduler. Set before any coroutine awaits next().
+    void setAsyncWakeHook(std::function<void()> hook) { asyncWake_ = std::move(hook); }
+
+    // Queued tasks, those of parked tenants included; delayed tasks are not counted.
+    bool empty() const
+    {
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+        return queue_.empty();
+    }
+
+    std::size_t size() const
+    {
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+        return queue_.size();
+    }
+
+    // Token bucket for a tenant (rate_limiter.h), charged Task::cost per dispatch and shared
+    // by all bands; perSecond <= 0 removes the limit. Takes effect at once, including for a
+    // tenant that is currently parked.
+    void setTenantRateLimit(const std::string& tenantId, RateLimit limit)
+    {
+        static_assert(QueuePolicy::kTenants, "rate limits are per tenant");
+
+        std::size_t unparked = 0;
+        TaskWaiter* served = nullptr;
+        OwedWakes owed;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            const IdInterner::Handle tenant = tenants_.intern(tenantId);
+            if (tenant >= limits_.size()) limits_.resize(tenant + 1);
+
+            limits_[tenant].bucket.configure(limit, Clock::now());
+            unparked = unparkUnlocked(tenant);
+            if (unparked) served = handOffUnlocked();
+            owed = takeWakesUnlocked();
+        }
+        resumeWaiters(served);
+        if (unparked) wait_.notifyUpTo(unparked, unparked);
+        payWakes(owed);
+    }
+
+    // Retries are off until a policy with maxAttempts > 0 is set (retry_policy.h). With a
+    // policy, every dispatched task stays tracked until complete() or fail() reports on it.
+    void setRetryPolicy(RetryPolicy policy) { retries_.setPolicy(policy); }
+
+    // Worker report for a task it got from getNext(). Failed is the same as fail().
+    // Returns false if the task is not in flight. A task that is still queued, delayed or
+    // blocked is left alone: nothing is logged and its dependents stay blocked.
+    bool complete(const std::string& taskId, TaskStatus status = TaskStatus::Succeeded)
+    {
+        if (status == TaskStatus::Failed) return fail(taskId);
+        const bool tracked = retries_.complete(taskId);
+        if (!tracked && !untrackedReportApplies(taskId)) return false;
+        logCompleted(taskId);
+        if (hasGraph_.load(std::memory_order_relaxed)) releaseDependents(taskId);
+        return tracked;
+    }
+
+    // Resubmits the failed task (attempt + 1) after a jittered exponential backoff, or moves
+    // it to the dead-letter queue once it has used maxAttempts runs (or on shutdown).
+    // The retry goes through submitAfter(), so it joins the back of its lane like new work.
+    // Returns false if the task is not in flight.
+    bool fail(const std::string& taskId)
+    {
+        std::optional<typename RetryTracker<Task>::Retry> retry;
+        if (retries_.fail(taskId, retry) == RetryTracker<Task>::Outcome::Unknown)
+        {
+            if (!untrackedReportApplies(taskId)) return false;
+            logCompleted(taskId); // not tracked (no retry policy): the task is over
+            if (hasGraph_.load(std::memory_order_relaxed)) dropDependents(taskId);
+            return false;
+        }
+
+        // The retry's Submit record supersedes the failed run in the log.
+        if (retry && submitAfter(retry->task, retry->delay))
+        {
+            metrics_.add(metrics::Counter::Retried);
+            return true;
+        }
+        logCompleted(taskId);
+        if (hasGraph_.load(std::memory_order_relaxed)) dropDependents(taskId);
+        if (retry) retries_.deadLetter(std::move(retry->task));
+        metrics_.add(metrics::Counter::DeadLettered);
+        return true;
+    }
+
+    // Replays `log` into this scheduler (delayed tasks stay delayed; overdue ones are due
+    // now), then logs every submit, cancel and completion to it. Call once, before any
+    // producer or worker uses the scheduler; the log must outlive it. With a log, workers
+    // should report every task with complete()/fail(): unreported tasks come back after a
+    // restart (at-least-once). Dead letters are not persisted. Returns the tasks recovered.
+    // A template so that only callers, which include task_log.h, need TaskLog.
+    template <typename Log>
+    std::size_t attachLog(Log& log)
+    {
+        static_assert(std::is_base_of<DurableLog, Log>::value, "attachLog() takes a TaskLog (task_log.h)");
+
+        std::size_t recovered = 0, idle = 0;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            log.replay([&](std::size_t n) { taskIds_.reserve(n); },
+                       [&](typename Log::Recovered&& r) {
+                           const TaskIdTable::Handle handle = admitUnlocked(std::move(r.task));
+                           if (r.due)
+                           {
+                               timers_.schedule(TimerRef{handle, taskIds_.generation(handle)}, *r.due);
+                               ++delayed_;
+                           }
+                           else
+                           {
+                               queue_.push(nodes_, handle);
+                           }
+                           ++recovered;
+                       });
+            log_ = &log;
+            idle = waiters_;
+        }
+        if (recovered) wait_.notifyUpTo(recovered, idle);
+        return recovered;
+    }
+
+    // Tasks that failed maxAttempts times, oldest first; the queue is emptied.
+    std::vector<Task> drainDeadLetters() { return retries_.drainDeadLetters(); }
+
+    std::size_t deadLetterSize() const { return retries_.deadLetterSize(); }
+
+    // Tasks waiting on submitAt/submitAfter deadlines (not counted by size()).
+    std::size_t delayedSize() const
+    {
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+        return delayed_;
+    }
+
+    // Tasks waiting on deps (not counted by size()).
+    std::size_t blockedSize() const
+    {
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+        return graph_.blocked();
+    }
+
+    // Counters, wait histograms and per-lane queue depth (see scheduler_metrics.h).
+    metrics::Snapshot metricsSnapshot() const
+    {
+        metrics::Snapshot s = metrics_.snapshot();
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+        queue_.forEachLane([&](int band, IdInterner::Handle tenant, std::size_t depth) {
+            s.depth.push_back(metrics::DepthGauge{QueuePolicy::kTenants ? tenants_.name(tenant) : std::string(),
+                                                  band, depth});
+        });
+        return s;
+    }
+
+    // metricsSnapshot() in Prometheus text exposition format.
+    std::string metricsText() const { return metrics::toPrometheus(metricsSnapshot(), QueuePolicy::kName); }
+
+protected:
+    static constexpr std::uint64_t bit(std::size_t band) { return std::uint64_t{1} << band; }
+
+    struct TimerRef
+    {
+        TaskIdTable::Handle handle;
+        std::uint32_t generation;
+    };
+
+    struct TenantLimit
+    {
+        TokenBucket bucket;            // unlimited until setTenantRateLimit()
+        std::uint64_t parkedBands = 0; // bit b set while parked off band b
+        std::uint32_t generation = 0;  // bumped by setTenantRateLimit(); stale ParkRefs are ignored
+    };
+
+    struct ParkRef
+    {
+        IdInterner::Handle tenant;
+        std::uint32_t band;
+        std::uint32_t generation;
+    };
+
+    // Normalizes and stores the task; not yet visible to getNext().
+    TaskIdTable::Handle admitUnlocked(Task t)
+    {
+        queue_.normalize(t);
+        const IdInterner::Handle tenant = QueuePolicy::kTenants ? tenants_.intern(t.tenant_id) : 0;
+        const TaskIdTable::Handle handle =
+            CancelPolicy::kEnabled ? taskIds_.acquire(t.task_id) : taskIds_.acquireUnindexed();
+        nodes_.emplace(handle, std::move(t), tenant);
+        return handle;
+    }
+
+    // Moves every delayed task whose deadline has passed into its lane.
+    void releaseDueUnlocked()
+    {
+        if (timers_.empty()) return;
+
+        std::size_t released = 0;
+        timers_.advance(Clock::now(), [&](TimerRef ref) {
+            // Skip timers whose task was canceled (and maybe recycled) meanwhile.
+            if (!taskIds_.isLive(ref.handle) || taskIds_.generation(ref.handle) != ref.generation)
+                return;
+            --delayed_;
+            queue_.push(nodes_, ref.handle);
+            ++released;
+        });
+
+        metrics_.add(metrics::Counter::DelayedReleased, released);
+
+        // The caller takes one; wake idle peers for the rest.
+        if (released > 1) owedWakes_ += released - 1;
+    }
+
+    // Charges the tenant's bucket, or parks the tenant in `band` and returns false.
+    bool admitTenantUnlocked(std::size_t band, IdInterner::Handle tenant, std::uint32_t cost)
+    {
+        if (tenant >= limits_.size() || !limits_[tenant].bucket.limited()) return true;
+
+        TenantLimit& l = limits_[tenant];
+        Clock::time_point readyAt;
+        if (l.bucket.tryTake(std::max<std::uint32_t>(cost, 1), Clock::now(), readyAt)) return true;
+
+        l.parkedBands |= bit(band);
+        throttled_.schedule(ParkRef{tenant, static_cast<std::uint32_t>(band), l.generation}, readyAt);
+        parkedSincePop_ = true;
+        metrics_.add(metrics::Counter::TenantsParked);
+        return false;
+    }
+
+    // Returns the tenant to every band it is parked in; returns how many.
+    std::size_t unparkUnlocked(IdInterner::Handle tenant)
+    {
+        TenantLimit& l = limits_[tenant];
+        ++l.generation; // pending wheel entries for these parks go stale
+        std::size_t n = 0;
+        for (std::uint64_t mask = l.parkedBands; mask; mask &= mask - 1, ++n)
+            queue_.unpark(lowestSetBit(mask), tenant);
+        l.parkedBands = 0;
+        return n;
+    }
+
+    // Returns tenants whose refill time has passed to their lanes.
+    void releaseThrottledUnlocked()
+    {
+        if (throttled_.empty()) return;
+
+        std::size_t released = 0;
+        throttled_.advance(Clock::now(), [&](ParkRef ref) {
+            TenantLimit& l = limits_[ref.tenant];
+            if (l.generation != ref.generation || !(l.parkedBands & bit(ref.band)))
+                return;
+            l.parkedBands &= ~bit(ref.band);
+            queue_.unpark(ref.band, ref.tenant);
+            ++released;
+        });
+
+        if (released > 1) owedWakes_ += released - 1;
+    }
+
+    // Earliest delayed task or tenant refill, if any.
+    std::optional<Clock::time_point> nextWakeUnlocked() const
+    {
+        auto due = timers_.nextDeadline();
+        auto refill = throttled_.nextDeadline();
+        if (!due) return refill;
+        if (!refill) return due;
+        return std::min(*due, *refill);
+    }
+
+    // Sleeps until the policy has runnable work (delayed tasks and refilled tenants are
+    // released first), or shutdown. Queued work of parked tenants doesn't count.
+    void waitForWorkUnlocked(std::unique_lock<std::mutex>& lock)
+    {
+        ++waiters_;
+        for (;;)
+        {
+            releaseDueUnlocked();
+            releaseThrottledUnlocked();
+            if (shutdown_ || queue_.runnable()) break;
+            if (owedWakes_)
+            {
+                unlockAndWake(lock);
+                lock.lock();
+                continue;
+            }
+
+            const metrics::Clock::time_point start = metrics::now();
+            wait_.sleep(lock, nextWakeUnlocked());
+            metrics_.recordSince(metrics::Histogram::WorkWaitNs, start);
+        }
+        --waiters_;
+    }
+
+    // Gives queued work to parked async waiters, oldest waiter first, while both last.
+    // Returns the served waiters (to resumeWaiters() after unlocking); counts them in `n`.
+    TaskWaiter* handOffUnlocked(std::size_t* n = nullptr)
+    {
+        TaskWaiter* served = nullptr;
+        TaskWaiter** tail = &served;
+        bool parked = false;
+        while (asyncHead_)
+        {
+            auto t = popOneUnlocked();
+            parked |= parkedSincePop_;
+            if (!t) break;
+
+            TaskWaiter* w = asyncHead_;
+            asyncHead_ = w->next;
+            if (!asyncHead_) asyncTail_ = nullptr;
+            w->task = retries_.track(std::move(t));
+            w->next = nullptr;
+            *tail = w;
+            tail = &w->next;
+            if (n) ++*n;
+        }
+        if (parked) wakeAsyncIfEarlierUnlocked(); // the executor must poll at the refill time
+        return served;
+    }
+
+    // Pokes the executor if the next deadline is earlier than the one its last pollAsync()
+    // returned. A task delayed while no coroutine was parked is only noticed here once
+    // one parks, so every path that parks or adds a deadline checks.
+    void wakeAsyncIfEarlierUnlocked()
+    {
+        const std::optional<Clock::time_point> next = nextWakeUnlocked();
+        if (!next || (asyncPollAt_ && *asyncPollAt_ <= *next)) return;
+        asyncPollAt_ = next; // the poll it triggers sets it again
+        asyncWake_();
+    }
+
+    static void resumeWaiters(TaskWaiter* w)
+    {
+        while (w)
+        {
+            TaskWaiter* next = w->next; // w may be gone once resumed
+            w->resume(w);
+            w = next;
+        }
+    }
+
+    // Queues a task whose deps are done. Its Submit record is written only now, so a replay
+    // never runs it ahead of its deps. Returns the record's LSN (0 without a log).
+    std::uint64_t queueReleasedUnlocked(TaskIdTable::Handle handle)
+    {
+        const std::uint64_t lsn = log_ ? log_->logSubmit(nodes_[handle].task) : 0;
+        queue_.push(nodes_, handle);
+        return lsn;
+    }
+
+    // complete()/fail() on a task the retry tracker doesn't know. With tracking on, it isn't
+    // in flight. With tracking off, it may have been dispatched, unless its ID is still
+    // live here (queued, delayed or blocked): only then is the report logged and applied to
+    // its dependents. Without a log or dependencies there is nothing to apply either way.
+    // NoCancel doesn't index IDs, so there every untracked report applies.
+    bool untrackedReportApplies(const std::string& taskId) const
+    {
+        if (retries_.enabled()) return false;
+        if (!log_ && !hasGraph_.load(std::memory_order_relaxed)) return false;
+        auto lock = metrics::lockTimed(mtx_, metrics_);
+        return !taskIds_.findLive(taskId);
+    }
+
+    // Waits for record `lsn` (0: nothing logged). False, counted as not_durable, if the log
+    // has failed: the caller's submit or cancel took effect but won't survive a restart.
+    bool waitDurable(std::uint64_t lsn)
+    {
+        if (!lsn || log_->waitDurable(lsn)) return true;
+        metrics_.add(metrics::Counter::NotDurable);
+        return false;
+    }
+
+    // `taskId` is done: queues the dependents it was the last dep of.
+    void releaseDependents(const std::string& taskId)
+    {
+        std::size_t released = 0, handed = 0, idle = 0;
+        TaskWaiter* served = nullptr;
+        OwedWakes owed;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            graph_.complete(taskId, [&](TaskIdTable::Handle h) {
+                queueReleasedUnlocked(h); // rides the next group commit, like the completion
+                ++released;
+            });
+            if (released == 0) return;
+            served = handOffUnlocked(&handed);
+            idle = waiters_;
+            owed = takeWakesUnlocked();
+        }
+        metrics_.add(metrics::Counter::Unblocked, released);
+        resumeWaiters(served);
+        if (handed < released) wait_.notifyUpTo(released - handed, idle);
+        payWakes(owed);
+    }
+
+    // `taskId` will never complete: its blocked dependents go too. Returns how many.
+    std::size_t dropDependentsUnlocked(const std::string& taskId)
+    {
+        std::size_t dropped = 0;
+        graph_.drop(taskId, [&](TaskIdTable::Handle h) {
+            nodes_[h].task = Task{};
+            taskIds_.release(h);
+            ++dropped;
+        });
+        return dropped;
+    }
+
+    void dropDependents(const std::string& taskId)
+    {
+        std::size_t dropped = 0;
+        {
+            auto lock = metrics::lockTimed(mtx_, metrics_);
+            dropped = dropDependentsUnlocked(taskId);
+        }
+        metrics_.add(metrics::Counter::DepsDropped, dropped);
+    }
+
+    // Completion records ride the next group commit: losing one in a crash only re-runs the task.
+    void logCompleted(const std::string& taskId)
+    {
+        if (log_) log_->logComplete(taskId);
+    }
+
+    // Wake-ups owed by the *Unlocked helpers, taken under mtx_ and paid once it is released.
+    struct OwedWakes
+    {
+        std::size_t n = 0;
+        std::size_t idle = 0;
+    };
+
+    OwedWakes takeWakesUnlocked() { return OwedWakes{std::exchange(owedWakes_, 0), waiters_}; }
+
+    void payWakes(OwedWakes owed)
+    {
+        if (owed.n) wait_.notifyUpTo(owed.n, owed.idle);
+    }
+
+    void unlockAndWake(std::unique_lock<std::mutex>& lock)
+    {
+        const OwedWakes owed = takeWakesUnlocked();
+        lock.unlock();
+        payWakes(owed);
+    }
+
+    std::optional<Task> popOneUnlocked()
+    {
+        auto admit = [this](std::size_t band, IdInterner::Handle tenant, TaskIdTable::Handle h) {
+            return admitTenantUnlocked(band, tenant, nodes_[h].task.cost);
+        };
+
+        parkedSincePop_ = false;
+        auto handle = queue_.pop(nodes_, admit, metrics_);
+
+        // A parked tenant's refill time may be earlier than what idle workers are sleeping
+        // on; wake one to re-arm so the tenant isn't stranded while this worker is busy.
+        if (parkedSincePop_ && waiters_ > 0) ++owedWakes_;
+        if (!handle) return std::nullopt;
+
+        taskIds_.release(*handle);
+        metrics_.add(metrics::Counter::Dequeued);
+        return std::move(nodes_[*handle].task);
+    }
+
+    QueuePolicy queue_;
+
+    IdInterner tenants_; // kTenants policies only
+    TaskIdTable taskIds_;
+    Nodes nodes_; // indexed by task handle
+
+    TimingWheel<TimerRef> timers_;
+    std::size_t delayed_ = 0;
+
+    DependencyGraph graph_;
+    std::atomic<bool> hasGraph_{false}; // set once: complete()/fail() skip the lock until then
+
+    std::vector<TenantLimit> limits_; // indexed by tenant handle; grown on first limit
+    TimingWheel<ParkRef> throttled_;  // (tenant, band) parks, keyed by refill time
+    bool parkedSincePop_ = false;
+
+    RetryTracker<Task> retries_; // own lock, always taken inside mtx_ when both are held
+
+    mutable std::mutex mtx_;
+    WaitPolicy wait_;
+    std::size_t waiters_ = 0;   // workers blocked in wait_.sleep
+    std::size_t owedWakes_ = 0; // see OwedWakes
+    bool shutdown_ = false;
+
+    TaskWaiter* asyncHead_ = nullptr; // parked async consumers, FIFO
+    TaskWaiter* asyncTail_ = nullptr;
+    std::function<void()> asyncWake_ = [] {};
+    std::optional<Clock::time_point> asyncPollAt_; // last deadline handed to the executor
+
+    mutable SchedulerMetrics metrics_; // mutable: const readers still time their lock waits
+
+    DurableLog* log_ = nullptr; // set once by attachLog(), before the scheduler is shared
+};
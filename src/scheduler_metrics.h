@@ -0,0 +1,462 @@
+// scheduler_metrics.h
+// C++17, STL only
+//
+// Hot-path counters and latency histograms for the schedulers.
+//
+// - Every thread records into its own shard (cache-line aligned, single writer), found
+//   through a thread_local cache, so recording never touches a shared cache line.
+//   snapshot() sums the shards; counts may be a few increments stale, never torn.
+// - The cache holds a thread's shards for its 8 most recently used registries. A shard that
+//   falls out of it, or whose thread exits, is folded into its registry's retired totals
+//   and freed, so neither threads nor registries grow without bound.
+// - Histograms are HDR-style log-linear: exact below 8, then 8 sub-buckets per power of
+//   two (<= 12.5% relative error), 0 .. 2^64 ns in 496 buckets.
+// - Clocks are only read on slow paths: lock acquisition that had to block (try_lock
+//   first) and waits for work.
+// - toPrometheus() renders a snapshot in the Prometheus text exposition format, with label
+//   values escaped.
+//
+// Build with -DSCHED_NO_METRICS to compile all of it out: SchedulerMetrics becomes an
+// empty class whose methods are no-ops, and lockTimed() is a plain lock.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace metrics
+{
+
+enum class Counter : std::size_t
+{
+    Submitted,       // tasks accepted by submit/submitBatch/submitAt
+    Dequeued,        // tasks handed to workers
+    Canceled,        // successful cancel() calls
+    CanceledSkipped, // dead entries passed over on pop: lazy cancel markers, or ring slots
+                     // of tenant lanes emptied by cancel()
+    BudgetResets,    // priority: budgets reset because only exhausted bands had work
+    Promoted,        // deadline: bands tasks aged up (a task that jumps k bands counts k)
+    TenantsParked,   // rate limit: a tenant parked until its bucket refills
+    DelayedReleased, // delayed tasks that came due
+    Retried,         // fail() resubmitted the task
+    DeadLettered,    // fail() gave up on the task
+    Unblocked,       // dependency graph: tasks queued once their last dep completed
+    DepsDropped,     // dependency graph: blocked tasks dropped with a canceled or failed dep
+    NotDurable,      // write-ahead log: submits/cancels applied in memory whose record failed to persist
+    Count
+};
+
+enum class Histogram : std::size_t
+{
+    LockWaitNs, // blocked acquiring the scheduler mutex (uncontended acquisitions not recorded)
+    WorkWaitNs, // asleep waiting for work (condition variable or park)
+    Count
+};
+
+inline const char* name(Counter c)
+{
+    static const char* const names[] = {"submitted",        "dequeued",      "canceled",
+                                        "canceled_skipped", "budget_resets", "promoted",
+                                        "tenants_parked",   "delayed_released", "retried",
+                                        "dead_lettered",    "unblocked",     "deps_dropped",
+                                        "not_durable"};
+    return names[static_cast<std::size_t>(c)];
+}
+
+inline const char* name(Histogram h)
+{
+    static const char* const names[] = {"lock_wait_ns", "work_wait_ns"};
+    return names[static_cast<std::size_t>(h)];
+}
+
+constexpr std::size_t kCounters = static_cast<std::size_t>(Counter::Count);
+constexpr std::size_t kHistograms = static_cast<std::size_t>(Histogram::Count);
+
+// Log-linear bucketing: values < 8 are exact, then 8 sub-buckets per power of two.
+constexpr unsigned kSubBits = 3;
+constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBits;
+constexpr std::size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+inline std::size_t bucketOf(std::uint64_t v)
+{
+    if (v < kSubBuckets) return static_cast<std::size_t>(v);
+#if defined(__GNUC__) || defined(__clang__)
+    const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(v));
+#else
+    unsigned msb = 0;
+    for (std::uint64_t x = v; x >>= 1;) ++msb;
+#endif
+    const std::size_t sub = static_cast<std::size_t>(v >> (msb - kSubBits)) & (kSubBuckets - 1);
+    return (msb - kSubBits + 1) * kSubBuckets + sub;
+}
+
+// Smallest value that lands in `bucket`.
+inline std::uint64_t bucketFloor(std::size_t bucket)
+{
+    if (bucket < kSubBuckets) return bucket;
+    const unsigned msb = static_cast<unsigned>(bucket / kSubBuckets) + kSubBits - 1;
+    const std::uint64_t sub = bucket % kSubBuckets;
+    return (kSubBuckets + sub) << (msb - kSubBits);
+}
+
+struct HistogramSummary
+{
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t max = 0;
+    std::uint64_t p50 = 0, p99 = 0, p999 = 0; // bucket floors: within 12.5% below the true value
+};
+
+// Queue depth for one tenant (and band, where the scheduler has bands).
+struct DepthGauge
+{
+    std::string tenant;
+    int band = -1; // -1: no bands
+    std::size_t depth = 0;
+};
+
+struct Snapshot
+{
+    std::array<std::uint64_t, kCounters> counters{};
+    std::array<HistogramSummary, kHistograms> histograms{};
+    std::vector<DepthGauge> depth; // filled by the scheduler, not by the registry
+
+    std::uint64_t operator[](Counter c) const { return counters[static_cast<std::size_t>(c)]; }
+    const HistogramSummary& operator[](Histogram h) const { return histograms[static_cast<std::size_t>(h)]; }
+};
+
+// Label values in the text format escape backslash, double quote and newline.
+inline std::string escapeLabel(const std::string& value)
+{
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '\\': out += "\\\\"; break;
+        case '"': out += "\\\""; break;
+        case '\n': out += "\\n"; break;
+        default: out += c;
+        }
+    }
+    return out;
+}
+
+inline std::string toPrometheus(const Snapshot& s, const std::string& scheduler)
+{
+    std::ostringstream out;
+    const std::string label = "scheduler=\"" + escapeLabel(scheduler) + "\"";
+
+    for (std::size_t i = 0; i < kCounters; ++i)
+    {
+        const std::string metric = std::string("sched_") + name(static_cast<Counter>(i)) + "_total";
+        out << "# TYPE " << metric << " counter\n"
+            << metric << "{" << label << "} " << s.counters[i] << "\n";
+    }
+
+    for (std::size_t i = 0; i < kHistograms; ++i)
+    {
+        const HistogramSummary& h = s.histograms[i];
+        const std::string metric = std::string("sched_") + name(static_cast<Histogram>(i));
+        out << "# TYPE " << metric << " summary\n"
+            << metric << "{" << label << ",quantile=\"0.5\"} " << h.p50 << "\n"
+            << metric << "{" << label << ",quantile=\"0.99\"} " << h.p99 << "\n"
+            << metric << "{" << label << ",quantile=\"0.999\"} " << h.p999 << "\n"
+            << metric << "_sum{" << label << "} " << h.sum << "\n"
+            << metric << "_count{" << label << "} " << h.count << "\n";
+    }
+
+    out << "# TYPE sched_queue_depth gauge\n";
+    for (const DepthGauge& g : s.depth)
+    {
+        out << "sched_queue_depth{" << label << ",tenant=\"" << escapeLabel(g.tenant) << "\"";
+        if (g.band >= 0) out << ",band=\"" << g.band << "\"";
+        out << "} " << g.depth << "\n";
+    }
+    return out.str();
+}
+
+using Clock = std::chrono::steady_clock;
+
+#ifndef SCHED_NO_METRICS
+
+class Registry
+{
+public:
+    Registry() : state_(std::make_shared<State>()), id_(nextId().fetch_add(1, std::memory_order_relaxed)) {}
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    void add(Counter c, std::uint64_t n = 1)
+    {
+        bump(shard().counters[static_cast<std::size_t>(c)], n);
+    }
+
+    void record(Histogram h, std::uint64_t value)
+    {
+        HistogramShard& hs = shard().histograms[static_cast<std::size_t>(h)];
+        bump(hs.buckets[bucketOf(value)], 1);
+        bump(hs.sum, value);
+        if (value > hs.max.load(std::memory_order_relaxed))
+            hs.max.store(value, std::memory_order_relaxed);
+    }
+
+    void recordSince(Histogram h, Clock::time_point start)
+    {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        record(h, ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+    }
+
+    Snapshot snapshot() const
+    {
+        Snapshot s;
+        std::array<std::array<std::uint64_t, kBuckets>, kHistograms> buckets{};
+
+        {
+            std::lock_guard<std::mutex> lock(state_->mtx);
+            auto sum = [&](const Shard& sh)
+            {
+                for (std::size_t i = 0; i < kCounters; ++i)
+                    s.counters[i] += sh.counters[i].load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < kHistograms; ++i)
+                {
+                    const HistogramShard& hs = sh.histograms[i];
+                    for (std::size_t b = 0; b < kBuckets; ++b)
+                        buckets[i][b] += hs.buckets[b].load(std::memory_order_relaxed);
+                    s.histograms[i].sum += hs.sum.load(std::memory_order_relaxed);
+                    s.histograms[i].max = std::max(s.histograms[i].max, hs.max.load(std::memory_order_relaxed));
+                }
+            };
+            sum(state_->retired);
+            for (const auto& sh : state_->shards) sum(*sh);
+        }
+
+        for (std::size_t i = 0; i < kHistograms; ++i)
+        {
+            HistogramSummary& h = s.histograms[i];
+            for (std::uint64_t n : buckets[i]) h.count += n;
+            h.p50 = quantile(buckets[i], h.count, 0.50);
+            h.p99 = quantile(buckets[i], h.count, 0.99);
+            h.p999 = quantile(buckets[i], h.count, 0.999);
+        }
+        return s;
+    }
+
+    // Per-thread shards currently live (threads that recorded recently and are still running).
+    std::size_t shardCount() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        return state_->shards.size();
+    }
+
+private:
+    struct HistogramShard
+    {
+        std::array<std::atomic<std::uint64_t>, kBuckets> buckets{};
+        std::atomic<std::uint64_t> sum{0};
+        std::atomic<std::uint64_t> max{0};
+    };
+
+    struct alignas(64) Shard
+    {
+        std::array<std::atomic<std::uint64_t>, kCounters> counters{};
+        std::array<HistogramShard, kHistograms> histograms{};
+    };
+
+    // Shared with the thread caches, which may outlive the registry.
+    struct State
+    {
+        std::mutex mtx; // guards shards and retired (registration, retirement, snapshot)
+        std::vector<std::unique_ptr<Shard>> shards;
+        Shard retired; // sums of the shards retired so far
+    };
+
+    struct CacheEntry
+    {
+        std::uint64_t registry;
+        Shard* shard;
+        std::weak_ptr<State> state;
+        std::uint64_t lastUse; // ThreadCache::tick at the last lookup; least is evicted
+    };
+
+    // Last shard looked up: the fast path, trivially destructible so it needs no TLS guard.
+    struct Hot
+    {
+        std::uint64_t registry;
+        Shard* shard;
+    };
+
+    // One thread's shards (at most kMaxCached); retired when the thread exits.
+    struct ThreadCache
+    {
+        std::vector<CacheEntry> entries;
+        std::uint64_t tick = 0;
+
+        ~ThreadCache()
+        {
+            hot_ = Hot{0, nullptr};
+            for (CacheEntry& e : entries) retire(e);
+        }
+    };
+
+    static constexpr std::size_t kMaxCached = 8;
+    static inline thread_local Hot hot_{0, nullptr};
+
+    static std::atomic<std::uint64_t>& nextId()
+    {
+        static std::atomic<std::uint64_t> id{1};
+        return id;
+    }
+
+    // Single writer per shard: a plain load + store, no locked read-modify-write.
+    static void bump(std::atomic<std::uint64_t>& a, std::uint64_t n)
+    {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Folds a shard into its registry's retired totals and frees it. Only the shard's own
+    // thread calls this, so nothing writes to it meanwhile. A destroyed registry took its
+    // shards with it.
+    static void retire(CacheEntry& e)
+    {
+        std::shared_ptr<State> state = e.state.lock();
+        if (!state) return;
+
+        std::lock_guard<std::mutex> lock(state->mtx);
+        Shard& to = state->retired;
+        for (std::size_t i = 0; i < kCounters; ++i)
+            bump(to.counters[i], e.shard->counters[i].load(std::memory_order_relaxed));
+        for (std::size_t i = 0; i < kHistograms; ++i)
+        {
+            HistogramShard& dst = to.histograms[i];
+            const HistogramShard& src = e.shard->histograms[i];
+            for (std::size_t b = 0; b < kBuckets; ++b)
+                bump(dst.buckets[b], src.buckets[b].load(std::memory_order_relaxed));
+            bump(dst.sum, src.sum.load(std::memory_order_relaxed));
+            dst.max.store(std::max(dst.max.load(std::memory_order_relaxed), src.max.load(std::memory_order_relaxed)),
+                          std::memory_order_relaxed);
+        }
+
+        auto& shards = state->shards;
+        auto it = std::find_if(shards.begin(), shards.end(), [&](const std::unique_ptr<Shard>& p) { return p.get() == e.shard; });
+        if (it != shards.end())
+        {
+            std::swap(*it, shards.back());
+            shards.pop_back();
+        }
+    }
+
+    // Registry ids are never reused, so entries of destroyed registries never match; they
+    // are dropped on the next miss.
+    Shard& shard()
+    {
+        if (hot_.registry == id_) return *hot_.shard;
+        return shardSlow();
+    }
+
+    Shard& shardSlow()
+    {
+        thread_local ThreadCache cache;
+        std::vector<CacheEntry>& entries = cache.entries;
+        for (CacheEntry& e : entries)
+        {
+            if (e.registry == id_)
+            {
+                e.lastUse = ++cache.tick;
+                hot_ = Hot{id_, e.shard};
+                return *e.shard;
+            }
+        }
+
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const CacheEntry& e) { return e.state.expired(); }),
+                      entries.end());
+        if (entries.size() >= kMaxCached)
+        {
+            auto lru = std::min_element(entries.begin(), entries.end(),
+                                        [](const CacheEntry& a, const CacheEntry& b) { return a.lastUse < b.lastUse; });
+            if (hot_.shard == lru->shard) hot_ = Hot{0, nullptr};
+            retire(*lru);
+            *lru = std::move(entries.back());
+            entries.pop_back();
+        }
+
+        Shard* s;
+        {
+            std::lock_guard<std::mutex> lock(state_->mtx);
+            state_->shards.push_back(std::make_unique<Shard>());
+            s = state_->shards.back().get();
+        }
+        entries.push_back(CacheEntry{id_, s, state_, ++cache.tick});
+        hot_ = Hot{id_, s};
+        return *s;
+    }
+
+    static std::uint64_t quantile(const std::array<std::uint64_t, kBuckets>& buckets,
+                                  std::uint64_t count, double q)
+    {
+        if (count == 0) return 0;
+        const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count - 1));
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < kBuckets; ++b)
+        {
+            seen += buckets[b];
+            if (seen > rank) return bucketFloor(b);
+        }
+        return bucketFloor(kBuckets - 1);
+    }
+
+    std::shared_ptr<State> state_;
+    const std::uint64_t id_;
+};
+
+inline Clock::time_point now() { return Clock::now(); }
+
+// Locks `m`; only a blocked acquisition reads the clock and is recorded as LockWaitNs.
+template <typename Mutex>
+std::unique_lock<Mutex> lockTimed(Mutex& m, Registry& reg)
+{
+    std::unique_lock<Mutex> lock(m, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        const Clock::time_point start = Clock::now();
+        lock.lock();
+        reg.recordSince(Histogram::LockWaitNs, start);
+    }
+    return lock;
+}
+
+#else // SCHED_NO_METRICS
+
+class Registry
+{
+public:
+    void add(Counter, std::uint64_t = 1) {}
+    void record(Histogram, std::uint64_t) {}
+    void recordSince(Histogram, Clock::time_point) {}
+    Snapshot snapshot() const { return {}; }
+    std::size_t shardCount() const { return 0; }
+};
+
+inline Clock::time_point now() { return {}; }
+
+template <typename Mutex>
+std::unique_lock<Mutex> lockTimed(Mutex& m, Registry&)
+{
+    return std::unique_lock<Mutex>(m);
+}
+
+#endif // SCHED_NO_METRICS
+
+} // namespace metrics
+
+using SchedulerMetrics = metrics::Registry;
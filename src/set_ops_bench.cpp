@@ -0,0 +1,173 @@
+// set_ops_bench.cpp
+// C++17, STL only (+ sorted_set_ops.h)
+//
+// Benchmark for the sorted-list kernels in sorted_set_ops.h.
+//
+//   g++ -std=c++17 -O2 -DNDEBUG src/set_ops_bench.cpp -o set_ops_bench
+//   ./set_ops_bench [--large N] [--reps R] > results.json
+//
+// Sweeps list-size ratio (large / small: 1, 4, ... 16384) x operation (intersect, merge) x
+// kernel: the branchy two-pointer loop dsa.cpp used to have, then every linear kernel set
+// this CPU supports; intersections also run galloping, binary probe and the automatic pick.
+// Lists are random sets of ints drawn from [0, 4 * large), so about a quarter of the small
+// list matches. Each run reports the best of R repetitions in ns per input value and its
+// speedup over the branchy loop.
+// A last section intersects K lists (sizes spread from large / 1024 to large, all sharing
+// 64 values so the result is not empty) with intersectMany() against folding the lists
+// pairwise in the given order, largest first.
+// Build with -DSETOPS_NO_SIMD to compare against the scalar kernels only.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "sorted_set_ops.h"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// `n` distinct values from [0, range), sorted.
+std::vector<int> randomSet(std::size_t n, int range, std::mt19937& rng)
+{
+    std::vector<int> v;
+    v.reserve(n + n / 4);
+    std::uniform_int_distribution<int> pick(0, range - 1);
+    while (v.size() < n)
+    {
+        while (v.size() < n + n / 4) v.push_back(pick(rng));
+        std::sort(v.begin(), v.end());
+        v.erase(std::unique(v.begin(), v.end()), v.end());
+    }
+    std::shuffle(v.begin(), v.end(), rng);
+    v.resize(n);
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+// Best-of-`reps` nanoseconds for one call of fn; `result` receives its return value.
+template <typename Fn>
+double bestNs(int reps, Fn&& fn, std::size_t& result)
+{
+    double best = 1e300;
+    for (int r = 0; r < reps; ++r)
+    {
+        const auto start = Clock::now();
+        result = fn();
+        const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        best = std::min(best, ns);
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t large = 1 << 20;
+    int reps = 5;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--large") && i + 1 < argc) large = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--reps") && i + 1 < argc) reps = std::atoi(argv[++i]);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--large N] [--reps R]\n";
+            return 2;
+        }
+    }
+    if (reps < 1) reps = 1;
+
+    std::vector<setops::Isa> kernels;
+    for (setops::Isa isa : {setops::Isa::Scalar, setops::Isa::Sse41, setops::Isa::Avx2})
+        if (static_cast<int>(isa) <= static_cast<int>(setops::activeIsa())) kernels.push_back(isa);
+
+    std::cout << "{\n  \"build\": {\"isa\": \"" << setops::isaName(setops::activeIsa()) << "\", \"large\": " << large
+              << ", \"reps\": " << reps << ", \"gallop_ratio\": " << setops::kGallopRatio << "},\n"
+              << "  \"results\": [\n";
+
+    std::mt19937 rng(42);
+    const int range = static_cast<int>(std::min<std::size_t>(4 * large, 0x7fffffff));
+    bool first = true;
+    for (std::size_t ratio : {1, 4, 16, 64, 256, 1024, 4096, 16384})
+    {
+        const std::vector<int> big = randomSet(large, range, rng);
+        const std::vector<int> small = randomSet(std::max<std::size_t>(large / ratio, 1), range, rng);
+        std::vector<int> out(big.size() + small.size() + setops::kOutSlack);
+        const double values = static_cast<double>(big.size() + small.size());
+
+        for (const char* op : {"intersect", "merge"})
+        {
+            const bool isect = op[0] == 'i';
+            std::size_t expected = 0;
+            const double baseline = bestNs(reps, [&] { return isect ? setops::detail::intersectBranchy(small, big, out.data()) : setops::detail::mergeBranchy(small, big, out.data()); }, expected);
+
+            auto report = [&](const char* kernel, double ns, std::size_t count)
+            {
+                std::cout << (first ? "" : ",\n") << "    {\"op\": \"" << op << "\", \"ratio\": " << ratio
+                          << ", \"kernel\": \"" << kernel << "\", \"ns_per_value\": " << ns / values
+                          << ", \"speedup\": " << baseline / ns << ", \"output\": " << count
+                          << (count == expected ? "" : ", \"MISMATCH\": true") << "}";
+                first = false;
+            };
+            report("branchy", baseline, expected);
+            for (setops::Isa isa : kernels)
+            {
+                std::size_t count = 0;
+                const double ns = bestNs(reps, [&] { return isect ? setops::intersectSets(small, big, out.data(), setops::Strategy::Linear, isa) : setops::merge(small, big, out.data(), isa); }, count);
+                report(setops::isaName(isa), ns, count);
+            }
+            if (!isect) continue;
+            for (setops::Strategy s : {setops::Strategy::Galloping, setops::Strategy::BinaryProbe, setops::Strategy::Auto})
+            {
+                std::size_t count = 0;
+                const double ns = bestNs(reps, [&] { return setops::intersectSets(small, big, out.data(), s); }, count);
+                report(s == setops::Strategy::Auto ? "auto" : setops::strategyName(s), ns, count);
+            }
+        }
+    }
+    std::cout << "\n  ],\n  \"k_way\": [\n";
+
+    first = true;
+    const std::vector<int> common = randomSet(64, range, rng);
+    for (std::size_t k : {5, 10, 20})
+    {
+        std::vector<std::vector<int>> lists;
+        for (std::size_t l = 0; l < k; ++l)
+        {
+            const std::size_t shift = 10 * l / (k - 1); // large >> 10 .. large
+            const std::vector<int> own = randomSet(std::max<std::size_t>(large >> (10 - shift), 1), range, rng);
+            lists.emplace_back();
+            std::set_union(own.begin(), own.end(), common.begin(), common.end(), std::back_inserter(lists.back()));
+        }
+        std::sort(lists.begin(), lists.end(), [](const std::vector<int>& x, const std::vector<int>& y) { return x.size() > y.size(); });
+        std::vector<setops::IntSpan> spans(lists.begin(), lists.end());
+
+        std::size_t folded = 0, many = 0;
+        std::vector<int> acc, next;
+        const double foldNs = bestNs(reps, [&]
+                                     {
+            acc = lists[0];
+            for (std::size_t l = 1; l < k; ++l)
+            {
+                next.resize(acc.size());
+                next.resize(setops::detail::intersectBranchy(acc, lists[l], next.data()));
+                acc.swap(next);
+            }
+            return acc.size(); }, folded);
+        const double manyNs = bestNs(reps, [&] { return setops::intersectMany(spans).size(); }, many);
+        std::cout << (first ? "" : ",\n") << "    {\"lists\": " << k << ", \"pairwise_ns\": " << foldNs
+                  << ", \"many_ns\": " << manyNs << ", \"speedup\": " << foldNs / manyNs << ", \"output\": " << many
+                  << (many == folded ? "" : ", \"MISMATCH\": true") << "}";
+        first = false;
+    }
+    std::cout << "\n  ]\n}\n";
+    return 0;
+}
@@ -0,0 +1,731 @@
+// shm_task_queue.h
+// C++17, STL + POSIX (shm_open/mmap, process-shared pthread mutex and condition variables)
+//
+// Task queue in a named shared-memory segment, so producer and worker *processes* on one
+// host exchange Tasks directly: one copy into a slot, one copy out, no serialization and
+// no socket hop. Everything lives in one segment with fixed capacity:
+//
+//   header | Slot[capacity] | Lane[maxTenants] | ring[maxTenants] | laneIndex[] | Consumer[]
+//
+// - Modes (ShmQueueOptions::mode), picked by the creator:
+//     Fifo : one lane, arrival order (like FifoTaskScheduler).
+//     Fair : one lane per tenant, round-robin across tenants (like FairTaskScheduler in
+//            RoundRobin mode). Tenants are interned into the segment and never removed.
+// - One robust, process-shared mutex guards the segment; producers wait on notFull while
+//   the slots are used up (trySubmit() fails fast instead), consumers on notEmpty.
+// - Task IDs are limited to 63 bytes and tenant IDs to 31; submit() rejects longer ones.
+//   Cancel, delays, retries and rate limits are not available here.
+//
+// Crashes:
+// - A consumer handle holds the task it got until it calls complete() or asks for the
+//   next one (which acks it). If its process dies, the task is requeued at the front of
+//   its lane by whoever next notices: every blocked wait re-checks consumer PIDs every
+//   kReapInterval, and reap() does it on demand. Delivery is at-least-once.
+// - A process that dies holding the mutex hands the next locker EOWNERDEAD. Each slot's
+//   state word is the commit point of every operation, so the lanes, free list, ring and
+//   tenant index are rebuilt from the slots (O(capacity log capacity)) and the queue goes on.
+//   Without robust mutexes (macOS), such a crash still wedges the queue.
+//
+// Handles are not thread-safe: give each worker thread its own ShmTaskQueue::open().
+// On older glibc, link with -lrt.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scheduler_metrics.h"
+#include "task.h"
+
+enum class ShmQueueMode : std::uint32_t
+{
+    Fifo,
+    Fair,
+};
+
+struct ShmQueueOptions
+{
+    ShmQueueMode mode = ShmQueueMode::Fifo;
+    std::uint32_t capacity = 4096;   // task slots, queued and in flight together
+    std::uint32_t maxTenants = 256;  // Fair: distinct tenant IDs over the segment's lifetime
+    std::uint32_t maxConsumers = 64; // consumer handles attached at once
+};
+
+namespace shm
+{
+
+constexpr std::size_t kMaxTaskId = 64; // bytes per ID field; IDs are length-prefixed and shorter
+constexpr std::size_t kMaxTenantId = 32;
+constexpr std::uint64_t kMagic = 0x314B5341544D4853; // "SHMTASK1"
+constexpr std::uint32_t npos = ~std::uint32_t{0};
+constexpr std::chrono::milliseconds kReapInterval{100};
+constexpr std::chrono::seconds kOpenTimeout{5};
+
+enum class SlotState : std::uint32_t
+{
+    Free,
+    Queued,
+    InFlight,
+};
+
+// Queue order. Requeued tasks of dead consumers take front sequence numbers, so a
+// rebuild that sorts by seq puts them back where they were.
+constexpr std::uint64_t kFirstBackSeq = std::uint64_t{1} << 62;
+
+struct Slot
+{
+    SlotState state;      // commit point: written last on the way in, first on the way out
+    std::uint32_t next;   // free list or lane link
+    std::uint32_t lane;
+    std::uint32_t owner;  // consumer index while InFlight
+    std::uint64_t seq;
+    std::uint64_t ts;
+    std::uint64_t deadline;
+    std::int32_t priority;
+    std::uint32_t cost;
+    std::uint32_t attempt;
+    std::uint8_t idLen;
+    std::uint8_t tenantLen;
+    char id[kMaxTaskId];
+    char tenant[kMaxTenantId];
+};
+
+struct Lane
+{
+    std::uint32_t head;
+    std::uint32_t tail;
+    std::uint32_t count;
+    std::uint32_t inRing;
+    std::uint32_t nameLen;
+    char name[kMaxTenantId];
+};
+
+struct Consumer
+{
+    pid_t pid; // 0: free
+    std::uint32_t inFlight;
+};
+
+struct Header
+{
+    std::atomic<std::uint64_t> magic; // stored last by the creator
+    std::uint32_t mode;
+    std::uint32_t capacity;
+    std::uint32_t maxLanes;
+    std::uint32_t indexSize; // laneIndex entries, a power of two
+    std::uint32_t maxConsumers;
+    std::uint64_t bytes;
+
+    pthread_mutex_t mtx;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+
+    std::uint32_t freeHead;
+    std::uint32_t queued;
+    std::uint32_t laneCount;
+    std::uint32_t ringHead;
+    std::uint32_t ringSize;
+    std::uint32_t shutdown;
+    std::uint64_t backSeq;
+    std::uint64_t frontSeq;
+};
+
+constexpr std::size_t align64(std::size_t n) { return (n + 63) & ~std::size_t{63}; }
+
+struct Layout
+{
+    std::size_t slots, lanes, ring, index, consumers, bytes;
+
+    Layout(std::uint32_t capacity, std::uint32_t maxLanes, std::uint32_t indexSize, std::uint32_t maxConsumers)
+    {
+        slots = align64(sizeof(Header));
+        lanes = align64(slots + sizeof(Slot) * capacity);
+        ring = align64(lanes + sizeof(Lane) * maxLanes);
+        index = align64(ring + sizeof(std::uint32_t) * maxLanes);
+        consumers = align64(index + sizeof(std::uint32_t) * indexSize);
+        bytes = align64(consumers + sizeof(Consumer) * maxConsumers);
+    }
+};
+
+inline timespec deadlineIn(std::chrono::nanoseconds d)
+{
+    timespec ts{};
+#if defined(__linux__)
+    ::clock_gettime(CLOCK_MONOTONIC, &ts); // matches pthread_condattr_setclock below
+#else
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+    const long long ns = ts.tv_nsec + static_cast<long long>(d.count());
+    ts.tv_sec += static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+    return ts;
+}
+
+} // namespace shm
+
+class ShmTaskQueue
+{
+public:
+    // Creates the segment `name` ("/something"); fails if it already exists.
+    static std::unique_ptr<ShmTaskQueue> create(const std::string& name, ShmQueueOptions opts = {})
+    {
+        if (opts.capacity == 0 || opts.maxConsumers == 0) return nullptr;
+        const std::uint32_t maxLanes = opts.mode == ShmQueueMode::Fair ? std::max<std::uint32_t>(opts.maxTenants, 1) : 1;
+        std::uint32_t indexSize = 2;
+        while (indexSize < 2 * maxLanes) indexSize *= 2;
+        const shm::Layout layout(opts.capacity, maxLanes, indexSize, opts.maxConsumers);
+
+        const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) return nullptr;
+        if (::ftruncate(fd, static_cast<off_t>(layout.bytes)) != 0)
+        {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            return nullptr;
+        }
+        void* base = ::mmap(nullptr, layout.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            ::shm_unlink(name.c_str());
+            return nullptr;
+        }
+
+        std::unique_ptr<ShmTaskQueue> q(new ShmTaskQueue(static_cast<char*>(base), layout.bytes));
+        q->init(opts.mode, opts.capacity, maxLanes, indexSize, opts.maxConsumers);
+        return q;
+    }
+
+    // Maps an existing segment, waiting briefly for its creator to finish initializing it.
+    static std::unique_ptr<ShmTaskQueue> open(const std::string& name)
+    {
+        const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0) return nullptr;
+
+        const auto give_up = std::chrono::steady_clock::now() + shm::kOpenTimeout;
+        struct stat st{};
+        while (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) < sizeof(shm::Header))
+        {
+            if (std::chrono::steady_clock::now() > give_up) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (static_cast<std::size_t>(st.st_size) < sizeof(shm::Header))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+
+        const std::size_t bytes = static_cast<std::size_t>(st.st_size);
+        void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) return nullptr;
+
+        std::unique_ptr<ShmTaskQueue> q(new ShmTaskQueue(static_cast<char*>(base), bytes));
+        while (q->header().magic.load(std::memory_order_acquire) != shm::kMagic)
+        {
+            if (std::chrono::steady_clock::now() > give_up) return nullptr;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (q->header().bytes != bytes) return nullptr;
+        return q;
+    }
+
+    // Removes the name; processes that have it mapped keep using the segment.
+    static bool remove(const std::string& name) { return ::shm_unlink(name.c_str()) == 0; }
+
+    // Requeues an unacknowledged task, then detaches this handle's consumer slot.
+    ~ShmTaskQueue()
+    {
+        if (consumer_ != shm::npos)
+        {
+            Guard g(*this);
+            requeueInFlightUnlocked(consumer_);
+            consumers()[consumer_].pid = 0;
+        }
+        ::munmap(base_, bytes_);
+    }
+
+    ShmTaskQueue(const ShmTaskQueue&) = delete;
+    ShmTaskQueue& operator=(const ShmTaskQueue&) = delete;
+
+    ShmQueueMode mode() const noexcept { return static_cast<ShmQueueMode>(header().mode); }
+
+    // Blocks while every slot is in use. Returns false if shutdown or the IDs don't fit
+    // (or, in Fair mode, the tenant table is full).
+    bool submit(const Task& t) { return push(t, /*block=*/true); }
+
+    // Like submit(), but returns false at once if every slot is in use.
+    bool trySubmit(const Task& t) { return push(t, /*block=*/false); }
+
+    // Non-blocking. Acknowledges this handle's previous task, if any.
+    std::optional<Task> tryGetNext() { return pop(/*block=*/false); }
+
+    // Blocks until a task is available or shutdown() is called. Acknowledges this
+    // handle's previous task, if any.
+    std::optional<Task> getNext() { return pop(/*block=*/true); }
+
+    // Acknowledges the task this handle got last; its slot becomes free. Returns false
+    // if there is none.
+    bool complete()
+    {
+        if (consumer_ == shm::npos) return false;
+        bool acked = false;
+        {
+            Guard g(*this);
+            acked = ackUnlocked(consumer_);
+        }
+        if (acked) ::pthread_cond_signal(&header().notFull);
+        return acked;
+    }
+
+    // Wakes every waiter in every process; later submits and pops fail.
+    void shutdown()
+    {
+        {
+            Guard g(*this);
+            header().shutdown = 1;
+        }
+        ::pthread_cond_broadcast(&header().notEmpty);
+        ::pthread_cond_broadcast(&header().notFull);
+    }
+
+    // Requeues the in-flight tasks of consumers whose process has exited. Returns how many.
+    std::size_t reap()
+    {
+        std::size_t n = 0;
+        {
+            Guard g(*this);
+            n = reapUnlocked();
+        }
+        if (n) ::pthread_cond_broadcast(&header().notEmpty);
+        return n;
+    }
+
+    // Queued tasks (in-flight ones excluded).
+    std::size_t size()
+    {
+        Guard g(*this);
+        return header().queued;
+    }
+
+    bool empty() { return size() == 0; }
+
+    // Counters and wait histograms of this handle (see scheduler_metrics.h).
+    metrics::Snapshot metricsSnapshot() const { return metrics_.snapshot(); }
+    std::string metricsText() const { return metrics::toPrometheus(metricsSnapshot(), "shm"); }
+
+private:
+    // Locks the segment mutex; if its last owner died holding it, rebuilds the queue
+    // from the slot states first.
+    class Guard
+    {
+    public:
+        explicit Guard(ShmTaskQueue& q) : q_(q) { q_.recoverIfOwnerDied(::pthread_mutex_lock(&q_.header().mtx)); }
+        ~Guard() { ::pthread_mutex_unlock(&q_.header().mtx); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        // Waits up to kReapInterval; returns false on timeout.
+        bool wait(pthread_cond_t& cv)
+        {
+            const timespec deadline = shm::deadlineIn(shm::kReapInterval);
+            const int rc = ::pthread_cond_timedwait(&cv, &q_.header().mtx, &deadline);
+            q_.recoverIfOwnerDied(rc);
+            return rc != ETIMEDOUT;
+        }
+
+    private:
+        ShmTaskQueue& q_;
+    };
+
+    ShmTaskQueue(char* base, std::size_t bytes) : base_(base), bytes_(bytes) {}
+
+    shm::Header& header() const { return *reinterpret_cast<shm::Header*>(base_); }
+
+    shm::Layout layout() const
+    {
+        const shm::Header& h = header();
+        return shm::Layout(h.capacity, h.maxLanes, h.indexSize, h.maxConsumers);
+    }
+
+    shm::Slot* slots() const { return reinterpret_cast<shm::Slot*>(base_ + layout().slots); }
+    shm::Lane* lanes() const { return reinterpret_cast<shm::Lane*>(base_ + layout().lanes); }
+    std::uint32_t* ring() const { return reinterpret_cast<std::uint32_t*>(base_ + layout().ring); }
+    std::uint32_t* laneIndex() const { return reinterpret_cast<std::uint32_t*>(base_ + layout().index); }
+    shm::Consumer* consumers() const { return reinterpret_cast<shm::Consumer*>(base_ + layout().consumers); }
+
+    void init(ShmQueueMode mode, std::uint32_t capacity, std::uint32_t maxLanes, std::uint32_t indexSize,
+              std::uint32_t maxConsumers)
+    {
+        shm::Header& h = header();
+        h.mode = static_cast<std::uint32_t>(mode);
+        h.capacity = capacity;
+        h.maxLanes = maxLanes;
+        h.indexSize = indexSize;
+        h.maxConsumers = maxConsumers;
+        h.bytes = bytes_;
+
+        pthread_mutexattr_t ma;
+        ::pthread_mutexattr_init(&ma);
+        ::pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+#if defined(__linux__)
+        ::pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST);
+#endif
+        ::pthread_mutex_init(&h.mtx, &ma);
+        ::pthread_mutexattr_destroy(&ma);
+
+        pthread_condattr_t ca;
+        ::pthread_condattr_init(&ca);
+        ::pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+#if defined(__linux__)
+        ::pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+#endif
+        ::pthread_cond_init(&h.notEmpty, &ca);
+        ::pthread_cond_init(&h.notFull, &ca);
+        ::pthread_condattr_destroy(&ca);
+
+        shm::Slot* s = slots();
+        for (std::uint32_t i = 0; i < capacity; ++i)
+        {
+            s[i].state = shm::SlotState::Free;
+            s[i].next = i + 1 < capacity ? i + 1 : shm::npos;
+        }
+        h.freeHead = 0;
+        h.backSeq = shm::kFirstBackSeq;
+        h.frontSeq = shm::kFirstBackSeq - 1;
+
+        // Fifo: lane 0 is the queue, so pop() is the same ring walk in both modes.
+        if (mode == ShmQueueMode::Fifo) h.laneCount = 1;
+        resetLanesUnlocked();
+        rebuildLaneIndexUnlocked();
+
+        h.magic.store(shm::kMagic, std::memory_order_release);
+    }
+
+    bool push(const Task& t, bool block)
+    {
+        if (t.task_id.size() >= shm::kMaxTaskId || t.tenant_id.size() >= shm::kMaxTenantId) return false;
+
+        {
+            Guard g(*this);
+            shm::Header& h = header();
+            for (;;)
+            {
+                if (h.shutdown) return false;
+                if (h.freeHead != shm::npos) break;
+                if (!block) return false;
+
+                const metrics::Clock::time_point start = metrics::now();
+                if (!g.wait(h.notFull)) reapUnlocked();
+                metrics_.recordSince(metrics::Histogram::WorkWaitNs, start);
+            }
+
+            const std::uint32_t lane = mode() == ShmQueueMode::Fair ? internLaneUnlocked(t.tenant_id) : 0;
+            if (lane == shm::npos) return false;
+
+            const std::uint32_t i = h.freeHead;
+            shm::Slot& s = slots()[i];
+            h.freeHead = s.next;
+
+            s.lane = lane;
+            s.seq = h.backSeq++;
+            s.ts = t.ts;
+            s.deadline = t.deadline;
+            s.priority = t.priority;
+            s.cost = t.cost;
+            s.attempt = t.attempt;
+            s.idLen = static_cast<std::uint8_t>(t.task_id.size());
+            s.tenantLen = static_cast<std::uint8_t>(t.tenant_id.size());
+            std::memcpy(s.id, t.task_id.data(), s.idLen);
+            std::memcpy(s.tenant, t.tenant_id.data(), s.tenantLen);
+            s.state = shm::SlotState::Queued;
+
+            linkBackUnlocked(i);
+        }
+        metrics_.add(metrics::Counter::Submitted);
+        ::pthread_cond_signal(&header().notEmpty);
+        return true;
+    }
+
+    std::optional<Task> pop(bool block)
+    {
+        std::optional<Task> out;
+        bool acked = false;
+        {
+            Guard g(*this);
+            shm::Header& h = header();
+            if (!attachConsumerUnlocked()) return std::nullopt;
+            acked = ackUnlocked(consumer_);
+
+            for (;;)
+            {
+                if (h.shutdown) break;
+                if (h.ringSize > 0)
+                {
+                    out = takeUnlocked();
+                    break;
+                }
+                if (!block) break;
+
+                const metrics::Clock::time_point start = metrics::now();
+                if (!g.wait(h.notEmpty)) reapUnlocked();
+                metrics_.recordSince(metrics::Histogram::WorkWaitNs, start);
+            }
+        }
+        if (acked) ::pthread_cond_signal(&header().notFull);
+        if (out) metrics_.add(metrics::Counter::Dequeued);
+        return out;
+    }
+
+    // Round-robin over lanes with work: one task per lane turn.
+    Task takeUnlocked()
+    {
+        shm::Header& h = header();
+        const std::uint32_t lane = ring()[h.ringHead];
+        h.ringHead = (h.ringHead + 1) % h.maxLanes;
+        --h.ringSize;
+
+        shm::Lane& l = lanes()[lane];
+        const std::uint32_t i = l.head;
+        shm::Slot& s = slots()[i];
+        s.state = shm::SlotState::InFlight;
+        s.owner = consumer_;
+        consumers()[consumer_].inFlight = i;
+
+        l.head = s.next;
+        if (l.head == shm::npos) l.tail = shm::npos;
+        --l.count;
+        --h.queued;
+        if (l.count > 0) pushRingUnlocked(lane);
+        else l.inRing = 0;
+
+        Task t;
+        t.task_id.assign(s.id, s.idLen);
+        t.tenant_id.assign(s.tenant, s.tenantLen);
+        t.priority = s.priority;
+        t.ts = s.ts;
+        t.cost = s.cost;
+        t.attempt = s.attempt;
+        t.deadline = s.deadline;
+        return t;
+    }
+
+    void pushRingUnlocked(std::uint32_t lane)
+    {
+        shm::Header& h = header();
+        ring()[(h.ringHead + h.ringSize) % h.maxLanes] = lane;
+        ++h.ringSize;
+        lanes()[lane].inRing = 1;
+    }
+
+    void linkBackUnlocked(std::uint32_t i)
+    {
+        shm::Slot& s = slots()[i];
+        shm::Lane& l = lanes()[s.lane];
+        s.next = shm::npos;
+        if (l.tail != shm::npos) slots()[l.tail].next = i;
+        else l.head = i;
+        l.tail = i;
+        ++l.count;
+        ++header().queued;
+        if (!l.inRing) pushRingUnlocked(s.lane);
+    }
+
+    void linkFrontUnlocked(std::uint32_t i)
+    {
+        shm::Slot& s = slots()[i];
+        shm::Lane& l = lanes()[s.lane];
+        s.next = l.head;
+        l.head = i;
+        if (l.tail == shm::npos) l.tail = i;
+        ++l.count;
+        ++header().queued;
+        if (!l.inRing) pushRingUnlocked(s.lane);
+    }
+
+    // Lane for a tenant: open-addressed index over the lane names. Returns npos if full.
+    std::uint32_t internLaneUnlocked(const std::string& tenant)
+    {
+        shm::Header& h = header();
+        std::uint32_t* index = laneIndex();
+        const std::uint32_t mask = h.indexSize - 1;
+        for (std::uint32_t p = static_cast<std::uint32_t>(std::hash<std::string>{}(tenant)) & mask;; p = (p + 1) & mask)
+        {
+            if (index[p] == shm::npos) break;
+            const shm::Lane& l = lanes()[index[p]];
+            if (std::string_view(l.name, l.nameLen) == tenant) return index[p];
+        }
+        if (h.laneCount == h.maxLanes) return shm::npos;
+
+        const std::uint32_t lane = h.laneCount;
+        shm::Lane& l = lanes()[lane];
+        l.nameLen = static_cast<std::uint32_t>(tenant.size());
+        std::memcpy(l.name, tenant.data(), tenant.size());
+        h.laneCount = lane + 1; // commit point for the tenant; the index is derived
+        indexLaneUnlocked(lane);
+        return lane;
+    }
+
+    void indexLaneUnlocked(std::uint32_t lane)
+    {
+        const shm::Lane& l = lanes()[lane];
+        std::uint32_t* index = laneIndex();
+        const std::uint32_t mask = header().indexSize - 1;
+        std::uint32_t p = static_cast<std::uint32_t>(std::hash<std::string_view>{}(std::string_view(l.name, l.nameLen))) & mask;
+        while (index[p] != shm::npos) p = (p + 1) & mask;
+        index[p] = lane;
+    }
+
+    // Registers this handle as a consumer on its first pop.
+    bool attachConsumerUnlocked()
+    {
+        if (consumer_ != shm::npos) return true;
+        shm::Consumer* c = consumers();
+        for (std::uint32_t i = 0; i < header().maxConsumers; ++i)
+        {
+            if (c[i].pid != 0) continue;
+            c[i].pid = ::getpid();
+            c[i].inFlight = shm::npos;
+            consumer_ = i;
+            return true;
+        }
+        return false;
+    }
+
+    bool ackUnlocked(std::uint32_t consumer)
+    {
+        shm::Consumer& c = consumers()[consumer];
+        if (c.inFlight == shm::npos) return false;
+
+        shm::Slot& s = slots()[c.inFlight];
+        s.state = shm::SlotState::Free;
+        s.next = header().freeHead;
+        header().freeHead = c.inFlight;
+        c.inFlight = shm::npos;
+        return true;
+    }
+
+    void requeueInFlightUnlocked(std::uint32_t consumer)
+    {
+        shm::Consumer& c = consumers()[consumer];
+        if (c.inFlight == shm::npos) return;
+
+        shm::Slot& s = slots()[c.inFlight];
+        s.seq = header().frontSeq--;
+        s.state = shm::SlotState::Queued;
+        linkFrontUnlocked(c.inFlight);
+        c.inFlight = shm::npos;
+    }
+
+    std::size_t reapUnlocked()
+    {
+        std::size_t n = 0;
+        shm::Consumer* c = consumers();
+        const pid_t self = ::getpid();
+        for (std::uint32_t i = 0; i < header().maxConsumers; ++i)
+        {
+            if (c[i].pid == 0 || c[i].pid == self) continue;
+            if (::kill(c[i].pid, 0) == 0 || errno != ESRCH) continue;
+
+            if (c[i].inFlight != shm::npos) ++n;
+            requeueInFlightUnlocked(i);
+            c[i].pid = 0;
+        }
+        return n;
+    }
+
+    void recoverIfOwnerDied(int rc)
+    {
+#if defined(__linux__)
+        if (rc != EOWNERDEAD) return;
+        rebuildUnlocked();
+        reapUnlocked();
+        ::pthread_mutex_consistent(&header().mtx);
+#else
+        (void)rc;
+#endif
+    }
+
+    void resetLanesUnlocked()
+    {
+        shm::Header& h = header();
+        for (std::uint32_t i = 0; i < h.maxLanes; ++i)
+        {
+            shm::Lane& l = lanes()[i];
+            l.head = l.tail = shm::npos;
+            l.count = 0;
+            l.inRing = 0;
+        }
+        h.ringHead = h.ringSize = 0;
+        h.queued = 0;
+    }
+
+    void rebuildLaneIndexUnlocked()
+    {
+        std::fill(laneIndex(), laneIndex() + header().indexSize, shm::npos);
+        for (std::uint32_t lane = 0; lane < header().laneCount; ++lane) indexLaneUnlocked(lane);
+    }
+
+    // Everything but the slot states (and lane names) is derived, so a crash mid-operation
+    // is repaired by recomputing it: free list, lanes in seq order, ring, tenant index,
+    // and each consumer's in-flight slot.
+    void rebuildUnlocked()
+    {
+        shm::Header& h = header();
+        shm::Slot* s = slots();
+        resetLanesUnlocked();
+        rebuildLaneIndexUnlocked();
+        for (std::uint32_t i = 0; i < h.maxConsumers; ++i) consumers()[i].inFlight = shm::npos;
+
+        std::vector<std::uint32_t> queued;
+        h.freeHead = shm::npos;
+        for (std::uint32_t i = h.capacity; i-- > 0;)
+        {
+            if (s[i].state == shm::SlotState::InFlight && s[i].owner < h.maxConsumers &&
+                consumers()[s[i].owner].pid != 0 && consumers()[s[i].owner].inFlight == shm::npos)
+            {
+                consumers()[s[i].owner].inFlight = i;
+                continue;
+            }
+            if (s[i].state == shm::SlotState::Free)
+            {
+                s[i].next = h.freeHead;
+                h.freeHead = i;
+                continue;
+            }
+            if (s[i].state == shm::SlotState::InFlight) s[i].seq = h.frontSeq--; // owner is gone
+            s[i].state = shm::SlotState::Queued;
+            if (s[i].lane >= h.laneCount) s[i].lane = 0;
+            queued.push_back(i);
+        }
+
+        std::sort(queued.begin(), queued.end(), [&](std::uint32_t a, std::uint32_t b) { return s[a].seq < s[b].seq; });
+        for (std::uint32_t i : queued) linkBackUnlocked(i);
+    }
+
+    char* base_;
+    std::size_t bytes_;
+    std::uint32_t consumer_ = shm::npos; // this handle's consumer slot, once it has popped
+    SchedulerMetrics metrics_;
+};
@@ -0,0 +1,228 @@
+// slab_allocator.h
+// C++17, STL only
+//
+// Size-class slab allocator for the schedulers' small, short-lived allocations
+// (id index map nodes, tenant ring and work-stealing deque blocks).
+//
+// - One global arena per size class (16..512 bytes). Arenas carve blocks out of
+//   64 KiB chunks and never return memory to the OS: steady-state churn is free-list only.
+// - Each thread keeps a small cache per size class and trades blocks with the arena
+//   in batches, so the arena mutex is taken once per kBatch allocations at most.
+// - Anything bigger than the largest class (or over-aligned) goes to operator new.
+// - SlabAllocator<T> is a standard allocator, so it plugs into any STL container.
+//
+// Build with -DSCHED_NO_SLAB to route everything through operator new (A/B profiling).
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace slab
+{
+
+constexpr std::size_t kClassCount = 6; // 16, 32, 64, 128, 256, 512
+constexpr std::size_t kMinBlock = 16;
+constexpr std::size_t kMaxBlock = kMinBlock << (kClassCount - 1);
+constexpr std::size_t kChunkBytes = 64 * 1024;
+constexpr std::size_t kBatch = 32;
+
+inline std::size_t sizeClass(std::size_t bytes) noexcept
+{
+    std::size_t cls = 0;
+    std::size_t block = kMinBlock;
+    while (block < bytes)
+    {
+        block <<= 1;
+        ++cls;
+    }
+    return cls;
+}
+
+struct FreeBlock
+{
+    FreeBlock* next;
+};
+
+class Arena
+{
+public:
+    explicit Arena(std::size_t blockSize) : blockSize_(blockSize) {}
+
+    // Pops up to `n` blocks into `out` (singly linked). Returns how many.
+    std::size_t take(FreeBlock*& out, std::size_t n)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::size_t got = 0;
+        while (got < n)
+        {
+            if (!free_) carveChunkUnlocked();
+            FreeBlock* b = free_;
+            free_ = b->next;
+            b->next = out;
+            out = b;
+            ++got;
+        }
+        return got;
+    }
+
+    // Returns a singly linked run of blocks.
+    void give(FreeBlock* head, FreeBlock* tail)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        tail->next = free_;
+        free_ = head;
+    }
+
+private:
+    void carveChunkUnlocked()
+    {
+        auto* chunk = static_cast<char*>(::operator new(kChunkBytes));
+        chunks_.push_back(chunk);
+        for (std::size_t off = 0; off + blockSize_ <= kChunkBytes; off += blockSize_)
+        {
+            auto* b = reinterpret_cast<FreeBlock*>(chunk + off);
+            b->next = free_;
+            free_ = b;
+        }
+    }
+
+    std::mutex mtx_;
+    std::size_t blockSize_;
+    FreeBlock* free_ = nullptr;
+    std::vector<char*> chunks_;
+};
+
+// Intentionally leaked: thread caches flush into the arenas during thread exit,
+// which can run after static destructors on the main thread.
+inline Arena& arena(std::size_t cls)
+{
+    static std::array<Arena*, kClassCount>* arenas = [] {
+        auto* a = new std::array<Arena*, kClassCount>{};
+        for (std::size_t i = 0; i < kClassCount; ++i)
+            (*a)[i] = new Arena(kMinBlock << i);
+        return a;
+    }();
+    return *(*arenas)[cls];
+}
+
+class ThreadCache
+{
+public:
+    ~ThreadCache()
+    {
+        for (std::size_t cls = 0; cls < kClassCount; ++cls)
+            flush(cls, lists_[cls].count);
+    }
+
+    void* allocate(std::size_t cls)
+    {
+        List& l = lists_[cls];
+        if (!l.head)
+            l.count += arena(cls).take(l.head, kBatch);
+        FreeBlock* b = l.head;
+        l.head = b->next;
+        --l.count;
+        return b;
+    }
+
+    void deallocate(void* p, std::size_t cls)
+    {
+        List& l = lists_[cls];
+        auto* b = static_cast<FreeBlock*>(p);
+        b->next = l.head;
+        l.head = b;
+        if (++l.count > 2 * kBatch)
+            flush(cls, kBatch);
+    }
+
+private:
+    struct List
+    {
+        FreeBlock* head = nullptr;
+        std::size_t count = 0;
+    };
+
+    void flush(std::size_t cls, std::size_t n)
+    {
+        List& l = lists_[cls];
+        if (n == 0 || !l.head) return;
+
+        FreeBlock* head = l.head;
+        FreeBlock* tail = head;
+        std::size_t moved = 1;
+        while (moved < n && tail->next)
+        {
+            tail = tail->next;
+            ++moved;
+        }
+
+        l.head = tail->next;
+        l.count -= moved;
+        arena(cls).give(head, tail);
+    }
+
+    std::array<List, kClassCount> lists_{};
+};
+
+inline ThreadCache& threadCache()
+{
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+inline void* allocate(std::size_t bytes, std::size_t align)
+{
+#ifndef SCHED_NO_SLAB
+    if (bytes <= kMaxBlock && align <= alignof(std::max_align_t))
+        return threadCache().allocate(sizeClass(bytes));
+#endif
+    return ::operator new(bytes, std::align_val_t(align));
+}
+
+inline void deallocate(void* p, std::size_t bytes, std::size_t align) noexcept
+{
+#ifndef SCHED_NO_SLAB
+    if (bytes <= kMaxBlock && align <= alignof(std::max_align_t))
+    {
+        threadCache().deallocate(p, sizeClass(bytes));
+        return;
+    }
+#else
+    (void)bytes;
+#endif
+    ::operator delete(p, std::align_val_t(align));
+}
+
+} // namespace slab
+
+template <typename T>
+class SlabAllocator
+{
+public:
+    using value_type = T;
+
+    SlabAllocator() noexcept = default;
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(slab::allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        slab::deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    // Stateless: any instance can free what another allocated.
+    template <typename U>
+    bool operator==(const SlabAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const SlabAllocator<U>&) const noexcept { return false; }
+};
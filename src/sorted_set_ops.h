@@ -0,0 +1,540 @@
+// sorted_set_ops.h
+// C++17, STL + x86 SIMD intrinsics (SSE4.1 / AVX2, chosen at runtime; scalar elsewhere)
+//
+// Intersection and merge of sorted int lists, e.g. posting lists of tenant IDs.
+//
+// - Inputs are IntSpans (pointer + length), so vectors, arrays and slices of larger
+//   buffers all work without copies. Outputs go to a caller buffer or a returned vector.
+// - intersectSets(): strictly increasing inputs. Compares a block of A against a block of
+//   B in all rotations at once (4x4 with SSE4.1, 8x8 with AVX2), then compacts the
+//   matches of A's block with one shuffle from a lookup table. Whichever block has the
+//   smaller maximum advances, so neither list is revisited.
+// - intersect(): any sorted input, duplicates matched pairwise (multiset semantics of a
+//   two-pointer loop). Scalar.
+// - merge(): any sorted inputs. Bitonic merge network on registers (4+4 or 8+8 values
+//   per step), refilled from the list with the smaller next value.
+// - Scalar paths are branchless (cmov and index arithmetic) when the lists interleave, where
+//   a two-pointer loop mispredicts about every other step. When one list is kSkewRatio times
+//   longer its branches are predictable and the plain two-pointer loop is faster, so they
+//   switch to that.
+// - Skewed sizes: a linear pass is O(m + n) even when m is 100 and n is 10M. Both
+//   intersections look at the size ratio (chooseStrategy()): past kGallopRatio each value of
+//   the short list is looked up in the long one instead, by galloping (doubling steps from
+//   the last match, then a binary search: O(m log(n / m))) or, when the short list is so
+//   short that its values are ~n/m apart and doubling would cost more than it saves
+//   (m * m <= n), by a plain binary search over the rest of the long list (O(m log n)).
+// - intersectMany(): k-way intersection of sets, smallest list first. The running result
+//   only shrinks, so after the first pair every step is a skewed lookup, and an empty
+//   result stops the walk early.
+// - The kernel set is picked once per process from the CPU (activeIsa()); each call can
+//   also ask for a specific one (clamped to what the CPU has), which the benchmark uses.
+//
+// Build with -DSETOPS_NO_SIMD to compile the scalar kernels only (A/B profiling, non-GCC
+// toolchains). Kernels use GCC/Clang target attributes, so no -mavx2 is needed.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if !defined(SETOPS_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SETOPS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace setops
+{
+
+// Read-only view of sorted ints.
+struct IntSpan
+{
+    const int* data = nullptr;
+    std::size_t size = 0;
+
+    IntSpan() = default;
+    IntSpan(const int* d, std::size_t n) : data(d), size(n) {}
+    IntSpan(const std::vector<int>& v) : data(v.data()), size(v.size()) {}
+
+    const int* begin() const { return data; }
+    const int* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+    int operator[](std::size_t i) const { return data[i]; }
+};
+
+enum class Isa
+{
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+inline const char* isaName(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::Avx2: return "avx2";
+    case Isa::Sse41: return "sse4.1";
+    default: return "scalar";
+    }
+}
+
+inline Isa detectIsa()
+{
+#if defined(SETOPS_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+    if (__builtin_cpu_supports("sse4.1")) return Isa::Sse41;
+#endif
+    return Isa::Scalar;
+}
+
+// Best kernel set this CPU runs; detected on first use.
+inline Isa activeIsa()
+{
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+// How an intersection walks its inputs.
+enum class Strategy
+{
+    Auto,        // chooseStrategy()
+    Linear,      // both lists end to end (SIMD for sets)
+    Galloping,   // each value of the shorter list by exponential search in the longer one
+    BinaryProbe, // each value of the shorter list by binary search in the rest of the longer one
+};
+
+inline const char* strategyName(Strategy s)
+{
+    switch (s)
+    {
+    case Strategy::Linear: return "linear";
+    case Strategy::Galloping: return "galloping";
+    case Strategy::BinaryProbe: return "binary";
+    default: return "auto";
+    }
+}
+
+// Size ratio from which intersections look values up instead of scanning both lists.
+constexpr std::size_t kGallopRatio = 32;
+
+inline Strategy chooseStrategy(IntSpan a, IntSpan b)
+{
+    const std::size_t m = a.size < b.size ? a.size : b.size;
+    const std::size_t n = a.size < b.size ? b.size : a.size;
+    if (m == 0 || n < kGallopRatio * m) return Strategy::Linear;
+    return m * m <= n ? Strategy::BinaryProbe : Strategy::Galloping;
+}
+
+// intersectSets() may store up to this many values past the last match.
+constexpr std::size_t kOutSlack = 8;
+
+// Output room intersectSets(a, b, out) needs.
+inline std::size_t intersectCapacity(IntSpan a, IntSpan b)
+{
+    return (a.size < b.size ? a.size : b.size) + kOutSlack;
+}
+
+// Size ratio from which the scalar paths use branchy two-pointer loops.
+constexpr std::size_t kSkewRatio = 8;
+
+namespace detail
+{
+
+inline bool skewed(IntSpan a, IntSpan b)
+{
+    return a.size >= kSkewRatio * b.size || b.size >= kSkewRatio * a.size;
+}
+
+inline std::size_t intersectBranchy(IntSpan a, IntSpan b, int* out)
+{
+    std::size_t i = 0, j = 0, k = 0;
+    while (i < a.size && j < b.size)
+    {
+        if (a[i] == b[j])
+        {
+            out[k++] = a[i];
+            i++;
+            j++;
+        }
+        else if (a[i] < b[j])
+        {
+            i++;
+        }
+        else
+        {
+            j++;
+        }
+    }
+    return k;
+}
+
+inline std::size_t mergeBranchy(IntSpan a, IntSpan b, int* out)
+{
+    std::size_t i = 0, j = 0, k = 0;
+    while (i < a.size && j < b.size)
+    {
+        if (a[i] <= b[j]) out[k++] = a[i++];
+        else out[k++] = b[j++];
+    }
+    while (i < a.size) out[k++] = a[i++];
+    while (j < b.size) out[k++] = b[j++];
+    return k;
+}
+
+// Branchless two-pointer intersection from (i, j); returns the new output count.
+inline std::size_t intersectScalar(IntSpan a, IntSpan b, std::size_t i, std::size_t j, int* out, std::size_t k)
+{
+    while (i < a.size && j < b.size)
+    {
+        const int x = a[i], y = b[j];
+        out[k] = x; // overwritten unless it matched
+        k += x == y;
+        i += x <= y;
+        j += y <= x;
+    }
+    return k;
+}
+
+// Branchless merge of a[i..] and b[j..] into out[k..]; returns the new output count.
+inline std::size_t mergeScalar(IntSpan a, IntSpan b, std::size_t i, std::size_t j, int* out, std::size_t k)
+{
+    while (i < a.size && j < b.size)
+    {
+        const int x = a[i], y = b[j];
+        const bool takeB = y < x;
+        out[k++] = takeB ? y : x;
+        i += !takeB;
+        j += takeB;
+    }
+    if (i < a.size) std::memcpy(out + k, a.data + i, (a.size - i) * sizeof(int));
+    if (j < b.size) std::memcpy(out + k + (a.size - i), b.data + j, (b.size - j) * sizeof(int));
+    return k + (a.size - i) + (b.size - j);
+}
+
+// End of a SIMD merge: `held` (sorted, every value >= all output so far) plus what is left
+// of both lists. Merges `held` in with a three-way pick, then finishes two-way.
+inline std::size_t mergeTail(const int* held, std::size_t heldCount, IntSpan a, IntSpan b, std::size_t i,
+                             std::size_t j, int* out, std::size_t k)
+{
+    for (std::size_t h = 0; h < heldCount;)
+    {
+        const int v = held[h];
+        if (i < a.size && a[i] < v && (j >= b.size || a[i] <= b[j])) out[k++] = a[i++];
+        else if (j < b.size && b[j] < v) out[k++] = b[j++];
+        else out[k++] = held[h++];
+    }
+    return mergeScalar(a, b, i, j, out, k);
+}
+
+#if defined(SETOPS_X86)
+
+// Shuffle that packs the lanes set in a 4-bit (SSE, byte indices) or 8-bit (AVX2, lane
+// indices) match mask to the front.
+struct CompactTables
+{
+    std::uint8_t sse[16][16] = {};
+    std::uint32_t avx2[256][8] = {};
+
+    constexpr CompactTables()
+    {
+        for (int m = 0; m < 16; ++m)
+        {
+            int n = 0;
+            for (int lane = 0; lane < 4; ++lane)
+                if (m & (1 << lane))
+                {
+                    for (int byte = 0; byte < 4; ++byte)
+                        sse[m][n * 4 + byte] = static_cast<std::uint8_t>(lane * 4 + byte);
+                    ++n;
+                }
+        }
+        for (int m = 0; m < 256; ++m)
+        {
+            int n = 0;
+            for (int lane = 0; lane < 8; ++lane)
+                if (m & (1 << lane)) avx2[m][n++] = static_cast<std::uint32_t>(lane);
+        }
+    }
+};
+
+inline constexpr CompactTables kCompact{};
+
+__attribute__((target("sse4.1"))) inline std::size_t intersectSse41(IntSpan a, IntSpan b, int* out)
+{
+    std::size_t i = 0, j = 0, k = 0;
+    while (i + 4 <= a.size && j + 4 <= b.size)
+    {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data + j));
+        __m128i eq = _mm_cmpeq_epi32(va, vb);
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        const int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        const __m128i pick = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kCompact.sse[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), _mm_shuffle_epi8(va, pick));
+        k += static_cast<std::size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+
+        const int amax = a[i + 3], bmax = b[j + 3];
+        i += amax <= bmax ? 4 : 0;
+        j += bmax <= amax ? 4 : 0;
+    }
+    return intersectScalar(a, b, i, j, out, k);
+}
+
+__attribute__((target("avx2"))) inline std::size_t intersectAvx2(IntSpan a, IntSpan b, int* out)
+{
+    const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    std::size_t i = 0, j = 0, k = 0;
+    while (i + 8 <= a.size && j + 8 <= b.size)
+    {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.data + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b.data + j));
+        __m256i eq = _mm256_cmpeq_epi32(va, vb);
+        for (int r = 1; r < 8; ++r)
+        {
+            vb = _mm256_permutevar8x32_epi32(vb, rotate);
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, vb));
+        }
+        const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        const __m256i pick = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kCompact.avx2[mask]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k), _mm256_permutevar8x32_epi32(va, pick));
+        k += static_cast<std::size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+
+        const int amax = a[i + 7], bmax = b[j + 7];
+        i += amax <= bmax ? 8 : 0;
+        j += bmax <= amax ? 8 : 0;
+    }
+    return intersectScalar(a, b, i, j, out, k);
+}
+
+// Sorts the bitonic sequence in `v`: compare-exchange at distance 2, then 1.
+__attribute__((target("sse4.1"))) inline __m128i bitonicSort4(__m128i v)
+{
+    __m128i s = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm_blend_epi16(_mm_min_epi32(v, s), _mm_max_epi32(v, s), 0xF0);
+    s = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_blend_epi16(_mm_min_epi32(v, s), _mm_max_epi32(v, s), 0xCC);
+}
+
+// Sorted a, b -> lo: the 4 smallest of the 8, hi: the 4 largest, both sorted.
+__attribute__((target("sse4.1"))) inline void bitonicMerge4(__m128i a, __m128i b, __m128i& lo, __m128i& hi)
+{
+    b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 1, 2, 3)); // a ++ reversed b is bitonic
+    lo = bitonicSort4(_mm_min_epi32(a, b));
+    hi = bitonicSort4(_mm_max_epi32(a, b));
+}
+
+__attribute__((target("avx2"))) inline __m256i bitonicSort8(__m256i v)
+{
+    __m256i s = _mm256_permute2x128_si256(v, v, 0x01);
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, s), _mm256_max_epi32(v, s), 0xF0);
+    s = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, s), _mm256_max_epi32(v, s), 0xCC);
+    s = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_blend_epi32(_mm256_min_epi32(v, s), _mm256_max_epi32(v, s), 0xAA);
+}
+
+__attribute__((target("avx2"))) inline void bitonicMerge8(__m256i a, __m256i b, __m256i& lo, __m256i& hi)
+{
+    b = _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    lo = bitonicSort8(_mm256_min_epi32(a, b));
+    hi = bitonicSort8(_mm256_max_epi32(a, b));
+}
+
+// The register merge loop, shared by both widths. Each step emits the W smallest of the
+// 2W values in flight and refills from the list whose next value is smaller, which keeps
+// every value still held or unread >= everything emitted.
+#define SETOPS_MERGE_LOOP(W, Vec, load, store, mergeRegs)                                  \
+    if (a.size < (W) || b.size < (W)) return mergeBranchy(a, b, out);                      \
+    Vec held = load(reinterpret_cast<const Vec*>(a.data));                                 \
+    Vec next = load(reinterpret_cast<const Vec*>(b.data));                                 \
+    std::size_t i = (W), j = (W), k = 0;                                                   \
+    for (;;)                                                                               \
+    {                                                                                      \
+        Vec lo;                                                                            \
+        mergeRegs(held, next, lo, held);                                                   \
+        store(reinterpret_cast<Vec*>(out + k), lo);                                        \
+        k += (W);                                                                          \
+        const bool fromA = i < a.size && (j >= b.size || a[i] <= b[j]);                    \
+        if (fromA ? i + (W) > a.size : j + (W) > b.size) break;                            \
+        next = fromA ? load(reinterpret_cast<const Vec*>(a.data + i))                      \
+                     : load(reinterpret_cast<const Vec*>(b.data + j));                     \
+        (fromA ? i : j) += (W);                                                            \
+    }                                                                                      \
+    alignas(32) int rest[W];                                                               \
+    store(reinterpret_cast<Vec*>(rest), held);                                             \
+    return mergeTail(rest, (W), a, b, i, j, out, k)
+
+__attribute__((target("sse4.1"))) inline std::size_t mergeSse41(IntSpan a, IntSpan b, int* out)
+{
+    SETOPS_MERGE_LOOP(4, __m128i, _mm_loadu_si128, _mm_storeu_si128, bitonicMerge4);
+}
+
+__attribute__((target("avx2"))) inline std::size_t mergeAvx2(IntSpan a, IntSpan b, int* out)
+{
+    SETOPS_MERGE_LOOP(8, __m256i, _mm256_loadu_si256, _mm256_storeu_si256, bitonicMerge8);
+}
+
+#undef SETOPS_MERGE_LOOP
+
+#endif // SETOPS_X86
+
+inline Isa clampIsa(Isa wanted)
+{
+    const Isa have = activeIsa();
+    return static_cast<int>(wanted) < static_cast<int>(have) ? wanted : have;
+}
+
+inline std::size_t intersectFallback(IntSpan a, IntSpan b, int* out)
+{
+    return skewed(a, b) ? intersectBranchy(a, b, out) : intersectScalar(a, b, 0, 0, out, 0);
+}
+
+// First index >= from with b[index] >= x, or b.size: doubling steps, then a binary search
+// inside the last step.
+inline std::size_t gallop(IntSpan b, std::size_t from, int x)
+{
+    if (from >= b.size || b[from] >= x) return from;
+    std::size_t lo = from, step = 1; // b[lo] < x
+    while (lo + step < b.size && b[lo + step] < x)
+    {
+        lo += step;
+        step <<= 1;
+    }
+    const std::size_t hi = lo + step < b.size ? lo + step : b.size;
+    return static_cast<std::size_t>(std::lower_bound(b.data + lo + 1, b.data + hi, x) - b.data);
+}
+
+// Looks every value of `small` up in `big`, resuming after the previous position. A match
+// consumes the value in `big`, so repeats pair up as in a two-pointer loop.
+template <bool Gallop>
+std::size_t intersectLookup(IntSpan small, IntSpan big, int* out)
+{
+    std::size_t j = 0, k = 0;
+    for (std::size_t i = 0; i < small.size && j < big.size; ++i)
+    {
+        const int x = small[i];
+        j = Gallop ? gallop(big, j, x)
+                   : static_cast<std::size_t>(std::lower_bound(big.data + j, big.end(), x) - big.data);
+        if (j < big.size && big[j] == x)
+        {
+            out[k++] = x;
+            ++j;
+        }
+    }
+    return k;
+}
+
+// Runs a lookup strategy with the shorter list probing the longer one; false for Linear.
+inline bool intersectByLookup(Strategy s, IntSpan a, IntSpan b, int* out, std::size_t& count)
+{
+    if (s == Strategy::Auto) s = chooseStrategy(a, b);
+    if (s == Strategy::Linear) return false;
+    if (b.size < a.size) std::swap(a, b);
+    count = s == Strategy::Galloping ? intersectLookup<true>(a, b, out) : intersectLookup<false>(a, b, out);
+    return true;
+}
+
+} // namespace detail
+
+// a ∩ b for strictly increasing a and b into `out`, which must hold intersectCapacity(a, b)
+// values. Returns the number of matches, written in increasing order.
+inline std::size_t intersectSets(IntSpan a, IntSpan b, int* out, Strategy s = Strategy::Auto,
+                                 Isa isa = activeIsa())
+{
+    std::size_t count = 0;
+    if (detail::intersectByLookup(s, a, b, out, count)) return count;
+#if defined(SETOPS_X86)
+    switch (detail::clampIsa(isa))
+    {
+    case Isa::Avx2: return detail::intersectAvx2(a, b, out);
+    case Isa::Sse41: return detail::intersectSse41(a, b, out);
+    default: break;
+    }
+#else
+    (void)isa;
+#endif
+    return detail::intersectFallback(a, b, out);
+}
+
+inline std::vector<int> intersectSets(IntSpan a, IntSpan b, Strategy s = Strategy::Auto)
+{
+    std::vector<int> out(intersectCapacity(a, b));
+    out.resize(intersectSets(a, b, out.data(), s));
+    return out;
+}
+
+// a ∩ b for sorted a and b, repeats included: a value that is m times in a and n times in
+// b is output min(m, n) times. `out` must hold min(a.size, b.size) values.
+inline std::size_t intersect(IntSpan a, IntSpan b, int* out, Strategy s = Strategy::Auto)
+{
+    std::size_t count = 0;
+    if (detail::intersectByLookup(s, a, b, out, count)) return count;
+    return detail::intersectFallback(a, b, out);
+}
+
+inline std::vector<int> intersect(IntSpan a, IntSpan b, Strategy s = Strategy::Auto)
+{
+    std::vector<int> out(a.size < b.size ? a.size : b.size);
+    out.resize(intersect(a, b, out.data(), s));
+    return out;
+}
+
+// Values present in every one of `lists` (each strictly increasing), in increasing order.
+// Empty if `lists` is.
+inline std::vector<int> intersectMany(std::vector<IntSpan> lists)
+{
+    if (lists.empty()) return {};
+    std::sort(lists.begin(), lists.end(), [](IntSpan x, IntSpan y) { return x.size < y.size; });
+    if (lists.size() == 1) return std::vector<int>(lists[0].begin(), lists[0].end());
+
+    // Ping-pong between two buffers sized for the smallest list; results never outgrow it.
+    std::vector<int> result(lists[0].size + kOutSlack), scratch(result.size());
+    std::size_t count = intersectSets(lists[0], lists[1], result.data());
+    for (std::size_t l = 2; l < lists.size() && count > 0; ++l)
+    {
+        count = intersectSets(IntSpan(result.data(), count), lists[l], scratch.data());
+        result.swap(scratch);
+    }
+    result.resize(count);
+    return result;
+}
+
+// Sorted a and b merged into `out` (a.size + b.size values). Returns a.size + b.size.
+inline std::size_t merge(IntSpan a, IntSpan b, int* out, Isa isa = activeIsa())
+{
+#if defined(SETOPS_X86)
+    switch (detail::clampIsa(isa))
+    {
+    case Isa::Avx2: return detail::mergeAvx2(a, b, out);
+    case Isa::Sse41: return detail::mergeSse41(a, b, out);
+    default: break;
+    }
+#else
+    (void)isa;
+#endif
+    return detail::skewed(a, b) ? detail::mergeBranchy(a, b, out) : detail::mergeScalar(a, b, 0, 0, out, 0);
+}
+
+inline std::vector<int> merge(IntSpan a, IntSpan b, Isa isa = activeIsa())
+{
+    std::vector<int> out(a.size + b.size);
+    merge(a, b, out.data(), isa);
+    return out;
+}
+
+// True if v is strictly increasing (a set, as intersectSets() needs).
+inline bool isStrictlyIncreasing(IntSpan v)
+{
+    bool ok = true;
+    for (std::size_t i = 1; i < v.size; ++i) ok &= v[i - 1] < v[i];
+    return ok;
+}
+
+} // namespace setops
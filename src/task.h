@@ -0,0 +1,25 @@
+// task.h
+// C++17, STL only
+//
+// The task record every scheduler takes and hands back. Fields a scheduler doesn't
+// use are carried through untouched:
+// - FifoTaskScheduler     : ignores tenant_id, priority and cost.
+// - FairTaskScheduler     : groups by tenant_id; cost feeds DRR and rate limits.
+// - PriorityTaskScheduler : priority is the band (0 = P0, highest), clamped to 0..N-1.
+// - DeadlineTaskScheduler : priority is the starting band; deadline orders tasks within a band.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct Task
+{
+    std::string task_id;
+    std::string tenant_id;
+    int priority = 0;
+    std::uint64_t ts = 0;       // submit timestamp for tracking; never used for ordering
+    std::uint32_t cost = 1;     // DRR credits and rate-limit tokens this task takes
+    std::uint32_t attempt = 0;  // failed runs so far (see fail())
+    std::uint64_t deadline = 0; // steady_clock ns since epoch (deadlineAt()); 0 = band default
+};
@@ -0,0 +1,881 @@
+// task_log.h
+// C++17, STL + POSIX (open/write/fdatasync/mmap)
+//
+// Optional write-ahead log for queued tasks, so a restart doesn't drop the backlog.
+// Attach one to a scheduler with attachLog() (scheduler_core.h): it replays the log into
+// the scheduler, then logs every submit, cancel and completion. The schedulers only see
+// the DurableLog interface (durable_log.h); this header is the one that pulls in POSIX.
+//
+// - Records: Submit (the whole task, plus its due time if delayed), Cancel, Complete.
+//   Each is [u32 payload length][u32 CRC-32C][payload]; replay stops at the first
+//   torn or corrupt record and truncates it away. Native byte order.
+// - Group commit: appends only copy into a buffer under the log mutex. A caller that
+//   needs durability (waitDurable) either becomes the leader, writing the whole buffer
+//   with one write() + fdatasync() outside the mutex, or waits for the leader whose
+//   batch holds its record. One fsync covers every submit that arrived meanwhile.
+//   With flushInterval > 0 nobody waits: a background thread flushes on that period.
+// - Segments: wal-<seq>.log, rolled at segmentBytes. Open never appends to an old
+//   segment; it starts a new one.
+// - Replay memory-maps the segments and keys the live set by task ID as string_views
+//   into the mappings, so it allocates nothing per record until the live tasks are decoded.
+//   The latest Submit of an ID wins (a retry supersedes the failed run); Cancel and
+//   Complete remove it. Live tasks come back in the order of their latest Submit.
+// - Compaction: once the sealed segments reach compactAtBytes (and twice their size after
+//   the last compaction), a background thread rewrites them as one segment holding only
+//   live Submit records, renamed over the oldest sealed one, then deletes the rest oldest
+//   first (syncing the directory after each). A crash in between leaves the compacted
+//   segment followed by a suffix of the old history, whose Cancel and Complete records
+//   still follow the Submits they kill: same live set.
+// - Delayed tasks and Task::deadline are stored in wall-clock time and mapped back to
+//   steady_clock on replay; overdue tasks come back due now.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "durable_log.h"
+#include "task.h"
+
+struct TaskLogOptions
+{
+    std::size_t segmentBytes = std::size_t{64} << 20;    // roll the active segment past this
+    std::size_t compactAtBytes = std::size_t{256} << 20; // sealed bytes that trigger compaction; 0 = never
+    std::chrono::milliseconds flushInterval{0};          // 0: callers wait for fsync; > 0: async
+};
+
+namespace wal
+{
+
+enum class RecordType : std::uint8_t
+{
+    Submit = 1,
+    Cancel = 2,
+    Complete = 3,
+};
+
+constexpr char kMagic[8] = {'T', 'A', 'S', 'K', 'W', 'A', 'L', '1'};
+constexpr std::size_t kHeaderBytes = 8; // u32 length + u32 crc
+
+using Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+inline const Tables& crcTables()
+{
+    static const Tables tables = [] {
+        Tables t{};
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+            t[0][i] = c;
+        }
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            for (std::size_t s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+        return t;
+    }();
+    return tables;
+}
+
+// CRC-32C, slicing-by-8 (8 bytes per step), so checksums don't dominate replay.
+inline std::uint32_t crc32c(const char* data, std::size_t n)
+{
+    const Tables& t = crcTables();
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    std::uint32_t c = ~0u;
+    for (; n >= 8; p += 8, n -= 8)
+    {
+        std::uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= c; // little-endian layout assumed, like the rest of the record format
+        c = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    while (n--) c = (c >> 8) ^ t[0][(c ^ *p++) & 0xFF];
+    return ~c;
+}
+
+inline std::int64_t wallNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+inline std::int64_t steadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// --------- Encoding ---------
+class RecordWriter
+{
+public:
+    explicit RecordWriter(std::string& out, RecordType type) : out_(out), start_(out.size())
+    {
+        out_.append(kHeaderBytes, '\0');
+        put(static_cast<std::uint8_t>(type));
+    }
+
+    template <typename T>
+    void put(T v)
+    {
+        out_.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+    void putString(const std::string& s)
+    {
+        put(static_cast<std::uint32_t>(s.size()));
+        out_.append(s);
+    }
+
+    // Fills in the header.
+    void finish()
+    {
+        const std::size_t payload = out_.size() - start_ - kHeaderBytes;
+        const auto len = static_cast<std::uint32_t>(payload);
+        const std::uint32_t crc = crc32c(out_.data() + start_ + kHeaderBytes, payload);
+        std::memcpy(&out_[start_], &len, 4);
+        std::memcpy(&out_[start_ + 4], &crc, 4);
+    }
+
+private:
+    std::string& out_;
+    std::size_t start_;
+};
+
+class RecordReader
+{
+public:
+    RecordReader(const char* p, std::size_t n) : p_(p), end_(p + n) {}
+
+    template <typename T>
+    bool get(T& v)
+    {
+        if (static_cast<std::size_t>(end_ - p_) < sizeof(T)) return false;
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return true;
+    }
+
+    bool getString(std::string_view& s)
+    {
+        std::uint32_t n = 0;
+        if (!get(n) || static_cast<std::size_t>(end_ - p_) < n) return false;
+        s = std::string_view(p_, n);
+        p_ += n;
+        return true;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+// Read-only mapping of a whole file; empty if it can't be mapped.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st{};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                data_ = static_cast<const char*>(p);
+                size_ = static_cast<std::size_t>(st.st_size);
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// Calls fn(type, id, record) for each valid record after the magic (record = header +
+// payload). Returns the length of the valid prefix; anything after it is torn or corrupt.
+template <typename Fn>
+std::size_t scanSegment(const char* data, std::size_t size, Fn&& fn)
+{
+    if (size < sizeof(kMagic) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) return 0;
+
+    std::size_t pos = sizeof(kMagic);
+    while (size - pos >= kHeaderBytes)
+    {
+        std::uint32_t len, crc;
+        std::memcpy(&len, data + pos, 4);
+        std::memcpy(&crc, data + pos + 4, 4);
+        if (len == 0 || size - pos - kHeaderBytes < len) break;
+
+        const char* payload = data + pos + kHeaderBytes;
+        if (crc32c(payload, len) != crc) break;
+
+        RecordReader r(payload, len);
+        std::uint8_t type = 0;
+        std::string_view id;
+        if (!r.get(type) || !r.getString(id)) break;
+
+        fn(static_cast<RecordType>(type), id, std::string_view(data + pos, kHeaderBytes + len));
+        pos += kHeaderBytes + len;
+    }
+    return pos;
+}
+
+// Live Submit records by task ID, in the order of each ID's latest Submit.
+// The ID index is open-addressed (linear probing, backward-shift erase) over record
+// indexes, with keys read back from the mapped records: no node per task, which is what
+// makes a 10M-record replay take seconds rather than minutes.
+class LiveSet
+{
+public:
+    std::vector<std::string_view> records; // empty view: superseded, canceled or completed
+    std::size_t live = 0;
+
+    void reserve(std::size_t expectedRecords)
+    {
+        records.reserve(expectedRecords);
+        ids_.reserve(expectedRecords);
+        rehash(expectedRecords);
+    }
+
+    void apply(RecordType type, std::string_view id, std::string_view record)
+    {
+        const std::uint64_t hash = std::hash<std::string_view>{}(id);
+        std::size_t slot = find(id, hash);
+
+        if (type == RecordType::Submit)
+        {
+            const auto index = static_cast<std::uint32_t>(records.size());
+            records.push_back(record);
+            ids_.push_back(id);
+            if (slots_[slot].index != kEmpty)
+            {
+                records[slots_[slot].index] = std::string_view(); // superseded
+                slots_[slot].index = index;
+                return;
+            }
+            slots_[slot] = Slot{index, static_cast<std::uint32_t>(hash)};
+            ++live;
+            if (live * 4 >= slots_.size() * 3) rehash(slots_.size());
+            return;
+        }
+
+        if (slots_[slot].index == kEmpty) return; // already gone: e.g. completed after being canceled
+        records[slots_[slot].index] = std::string_view();
+        erase(slot);
+        --live;
+    }
+
+private:
+    struct Slot
+    {
+        std::uint32_t index; // into records / ids_, or kEmpty
+        std::uint32_t tag;   // low hash bits: most mismatches never touch the key
+    };
+
+    static constexpr std::uint32_t kEmpty = ~std::uint32_t{0};
+
+    std::size_t mask() const { return slots_.size() - 1; }
+
+    // Slot holding `id`, or the empty slot where it would go.
+    std::size_t find(std::string_view id, std::uint64_t hash) const
+    {
+        for (std::size_t i = hash & mask();; i = (i + 1) & mask())
+        {
+            const Slot& s = slots_[i];
+            if (s.index == kEmpty) return i;
+            if (s.tag == static_cast<std::uint32_t>(hash) && ids_[s.index] == id) return i;
+        }
+    }
+
+    void erase(std::size_t hole)
+    {
+        slots_[hole].index = kEmpty;
+        for (std::size_t i = (hole + 1) & mask(); slots_[i].index != kEmpty; i = (i + 1) & mask())
+        {
+            const std::size_t home = std::hash<std::string_view>{}(ids_[slots_[i].index]) & mask();
+            // Move back unless the entry's home lies cyclically in (hole, i].
+            if (((i - home) & mask()) >= ((i - hole) & mask()))
+            {
+                slots_[hole] = slots_[i];
+                slots_[i].index = kEmpty;
+                hole = i;
+            }
+        }
+    }
+
+    // Grows to fit `n` live IDs at <= 3/4 load.
+    void rehash(std::size_t n)
+    {
+        std::size_t cap = 16;
+        while (cap * 3 < n * 4 + 4) cap *= 2;
+        if (cap <= slots_.size()) cap = slots_.size() * 2;
+
+        std::vector<Slot> old(cap, Slot{kEmpty, 0});
+        old.swap(slots_);
+        for (const Slot& s : old)
+        {
+            if (s.index == kEmpty) continue;
+            std::size_t i = std::hash<std::string_view>{}(ids_[s.index]) & mask();
+            while (slots_[i].index != kEmpty) i = (i + 1) & mask();
+            slots_[i] = s;
+        }
+    }
+
+    std::vector<Slot> slots_ = std::vector<Slot>(16, Slot{kEmpty, 0});
+    std::vector<std::string_view> ids_; // by record index
+};
+
+} // namespace wal
+
+class TaskLog final : public DurableLog
+{
+public:
+    struct Recovered
+    {
+        Task task;
+        std::optional<Clock::time_point> due; // set for tasks that were submitted delayed
+    };
+
+    struct ReplayStats
+    {
+        std::size_t segments = 0;
+        std::size_t records = 0;
+        std::size_t live = 0;
+        std::size_t truncatedBytes = 0; // torn or corrupt tails cut off
+    };
+
+    // Opens (creating if needed) the log in `dir` and starts a fresh active segment.
+    // Returns nullptr if the directory or segment can't be created.
+    static std::unique_ptr<TaskLog> open(const std::string& dir, TaskLogOptions opts = {})
+    {
+        std::unique_ptr<TaskLog> log(new TaskLog(dir, opts));
+        if (!log->init()) return nullptr;
+        return log;
+    }
+
+    ~TaskLog() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        maintCv_.notify_all();
+        if (maintenance_.joinable()) maintenance_.join();
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (flushing_) flushed_.wait(lock);
+        if (!buf_.empty()) flushUnlocked(lock);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    TaskLog(const TaskLog&) = delete;
+    TaskLog& operator=(const TaskLog&) = delete;
+
+    // Replays every segment written before open(): calls reserve(liveCount) once, then
+    // onTask(Recovered&&) for each live task, oldest first. Call before appending.
+    template <typename Reserve, typename OnTask>
+    ReplayStats replay(Reserve&& reserve, OnTask&& onTask)
+    {
+        std::lock_guard<std::mutex> compactLock(compactMtx_);
+
+        std::vector<Segment> sealed;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            sealed = sealed_;
+        }
+
+        std::vector<std::unique_ptr<wal::MappedFile>> maps;
+        wal::LiveSet live;
+        ReplayStats stats;
+        scanInto(sealed, maps, live, stats);
+
+        const std::int64_t wallNow = wal::wallNs();
+        const std::int64_t steadyNow = wal::steadyNs();
+        const Clock::time_point now = Clock::now();
+
+        reserve(live.live);
+        for (std::string_view rec : live.records)
+        {
+            if (rec.empty()) continue;
+            if (auto r = decodeSubmit(rec, wallNow, steadyNow, now))
+            {
+                onTask(std::move(*r));
+                ++stats.live;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        lastReplay_ = stats;
+        return stats;
+    }
+
+    ReplayStats lastReplay() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return lastReplay_;
+    }
+
+    // Appends return a log sequence number for waitDurable(). Task IDs must be unique
+    // among live tasks; a Submit for a live ID replaces it.
+    std::uint64_t logSubmit(const Task& t, std::optional<Clock::time_point> due = std::nullopt) override
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        encodeSubmitUnlocked(t, due);
+        return ++appended_;
+    }
+
+    std::uint64_t logSubmitBatch(const Task* tasks, std::size_t count) override
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (std::size_t i = 0; i < count; ++i) encodeSubmitUnlocked(tasks[i], std::nullopt);
+        appended_ += count;
+        return appended_;
+    }
+
+    std::uint64_t logCancel(const std::string& taskId) override { return logKill(wal::RecordType::Cancel, taskId); }
+    std::uint64_t logComplete(const std::string& taskId) override { return logKill(wal::RecordType::Complete, taskId); }
+
+    // Blocks until record `lsn` is on disk (group commit); returns at once in async mode.
+    // Returns false once a write or fsync has failed: the log stops persisting from then on,
+    // and later appends are dropped instead of buffered.
+    bool waitDurable(std::uint64_t lsn) override
+    {
+        if (opts_.flushInterval.count() > 0) return ok();
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (durable_ < lsn && !failed_)
+        {
+            if (flushing_) flushed_.wait(lock);
+            else flushUnlocked(lock);
+        }
+        return !failed_;
+    }
+
+    // Forces everything appended so far to disk.
+    bool flush()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        const std::uint64_t lsn = appended_;
+        while (durable_ < lsn && !failed_)
+        {
+            if (flushing_) flushed_.wait(lock);
+            else flushUnlocked(lock);
+        }
+        return !failed_;
+    }
+
+    // Rewrites the sealed segments as one holding only live tasks. Runs on its own when
+    // compactAtBytes is reached; safe to call any time, concurrently with appends.
+    bool compact()
+    {
+        std::lock_guard<std::mutex> compactLock(compactMtx_);
+
+        std::vector<Segment> sealed;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            sealed = sealed_;
+        }
+        if (sealed.empty()) return true;
+
+        std::vector<std::unique_ptr<wal::MappedFile>> maps;
+        wal::LiveSet live;
+        ReplayStats stats;
+        scanInto(sealed, maps, live, stats);
+
+        // Written next to the oldest sealed segment, then renamed over it. It drops Cancel and
+        // Complete records, so it must replay before every Submit they killed.
+        const std::string target = segmentPath(sealed.front().seq);
+        const std::string tmp = target + ".tmp";
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+
+        std::string out(wal::kMagic, sizeof(wal::kMagic));
+        std::size_t bytes = 0;
+        bool good = true;
+        for (std::string_view rec : live.records)
+        {
+            if (rec.empty()) continue;
+            out.append(rec);
+            if (out.size() >= kWriteChunk)
+            {
+                good = good && writeAll(fd, out);
+                bytes += out.size();
+                out.clear();
+            }
+        }
+        good = good && writeAll(fd, out) && syncFd(fd);
+        bytes += out.size();
+        ::close(fd);
+        maps.clear();
+
+        if (!good || std::rename(tmp.c_str(), target.c_str()) != 0 || !syncDir())
+        {
+            std::remove(tmp.c_str());
+            return false;
+        }
+        // Oldest first, each removal durable before the next: whatever a crash leaves is a suffix.
+        for (std::size_t i = 1; i < sealed.size(); ++i)
+        {
+            std::remove(segmentPath(sealed[i].seq).c_str());
+            syncDir();
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        sealed_.erase(sealed_.begin(), sealed_.begin() + static_cast<std::ptrdiff_t>(sealed.size()));
+        sealed_.insert(sealed_.begin(), Segment{sealed.front().seq, bytes});
+        sealedBytes_ = 0;
+        for (const Segment& s : sealed_) sealedBytes_ += s.bytes;
+        compactAt_ = std::max(opts_.compactAtBytes, 2 * bytes);
+        return true;
+    }
+
+    bool ok() const noexcept { return !failed_.load(std::memory_order_relaxed); }
+
+    // Bytes appended but not written yet.
+    std::size_t bufferedBytes() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return buf_.size();
+    }
+
+    std::size_t segmentCount() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return sealed_.size() + 1;
+    }
+
+private:
+    struct Segment
+    {
+        std::uint64_t seq;
+        std::size_t bytes;
+    };
+
+    static constexpr std::size_t kWriteChunk = std::size_t{4} << 20;
+
+    TaskLog(std::string dir, TaskLogOptions opts)
+        : dir_(std::move(dir)), opts_(opts), compactAt_(opts.compactAtBytes)
+    {
+    }
+
+    bool init()
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        if (ec) return false;
+
+        std::uint64_t maxSeq = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(dir_, ec))
+        {
+            const std::string name = entry.path().filename().string();
+            unsigned long long seq = 0;
+            char tail[8] = {};
+            if (std::sscanf(name.c_str(), "wal-%llu.%7s", &seq, tail) != 2) continue;
+            if (std::strcmp(tail, "log") != 0)
+            {
+                std::filesystem::remove(entry.path(), ec); // leftover of an interrupted compaction
+                continue;
+            }
+            sealed_.push_back(Segment{seq, static_cast<std::size_t>(entry.file_size(ec))});
+            maxSeq = std::max<std::uint64_t>(maxSeq, seq);
+        }
+        if (ec) return false;
+
+        std::sort(sealed_.begin(), sealed_.end(), [](const Segment& a, const Segment& b) { return a.seq < b.seq; });
+        for (const Segment& s : sealed_) sealedBytes_ += s.bytes;
+
+        if (!openSegment(maxSeq + 1)) return false;
+        maintenance_ = std::thread([this] { maintain(); });
+        return true;
+    }
+
+    std::string segmentPath(std::uint64_t seq) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "wal-%016llu.log", static_cast<unsigned long long>(seq));
+        return dir_ + "/" + name;
+    }
+
+    bool openSegment(std::uint64_t seq)
+    {
+        const int fd = ::open(segmentPath(seq).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (fd < 0) return false;
+        if (!writeAll(fd, std::string(wal::kMagic, sizeof(wal::kMagic))) || !syncFd(fd) || !syncDir())
+        {
+            ::close(fd);
+            return false;
+        }
+        fd_ = fd;
+        activeSeq_ = seq;
+        activeBytes_ = sizeof(wal::kMagic);
+        return true;
+    }
+
+    static bool writeAll(int fd, const std::string& data)
+    {
+        const char* p = data.data();
+        std::size_t left = data.size();
+        while (left > 0)
+        {
+            const ssize_t n = ::write(fd, p, left);
+            if (n < 0)
+            {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            left -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    static bool syncFd(int fd)
+    {
+#if defined(__APPLE__)
+        return ::fcntl(fd, F_FULLFSYNC) == 0; // fsync() alone doesn't reach the platter on macOS
+#else
+        return ::fdatasync(fd) == 0;
+#endif
+    }
+
+    // Makes creates, renames and removes in dir_ durable.
+    bool syncDir() const
+    {
+        const int fd = ::open(dir_.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        const bool good = ::fsync(fd) == 0;
+        ::close(fd);
+        return good;
+    }
+
+    void encodeSubmitUnlocked(const Task& t, std::optional<Clock::time_point> due)
+    {
+        if (failed_) return; // nothing is written any more: don't let the buffer grow
+
+        // Wall clock on disk: steady_clock restarts with the machine.
+        std::int64_t dueWall = 0, deadlineWall = 0;
+        if (due || t.deadline)
+        {
+            const std::int64_t wallNow = wal::wallNs();
+            const std::int64_t steadyNow = wal::steadyNs();
+            if (due)
+                dueWall = wallNow + std::chrono::duration_cast<std::chrono::nanoseconds>(*due - Clock::now()).count();
+            if (t.deadline)
+                deadlineWall = wallNow + (static_cast<std::int64_t>(t.deadline) - steadyNow);
+        }
+
+        wal::RecordWriter w(buf_, wal::RecordType::Submit);
+        w.putString(t.task_id);
+        w.putString(t.tenant_id);
+        w.put(static_cast<std::int32_t>(t.priority));
+        w.put(t.ts);
+        w.put(t.cost);
+        w.put(t.attempt);
+        w.put(deadlineWall);
+        w.put(dueWall);
+        w.finish();
+    }
+
+    static std::optional<Recovered> decodeSubmit(std::string_view rec, std::int64_t wallNow,
+                                                 std::int64_t steadyNow, Clock::time_point now)
+    {
+        wal::RecordReader r(rec.data() + wal::kHeaderBytes, rec.size() - wal::kHeaderBytes);
+        std::uint8_t type;
+        std::string_view id, tenant;
+        std::int32_t priority;
+        std::int64_t deadlineWall, dueWall;
+        Recovered out;
+        if (!r.get(type) || !r.getString(id) || !r.getString(tenant) || !r.get(priority) || !r.get(out.task.ts) ||
+            !r.get(out.task.cost) || !r.get(out.task.attempt) || !r.get(deadlineWall) || !r.get(dueWall))
+            return std::nullopt;
+
+        out.task.task_id.assign(id);
+        out.task.tenant_id.assign(tenant);
+        out.task.priority = priority;
+        if (deadlineWall)
+            out.task.deadline = static_cast<std::uint64_t>(std::max<std::int64_t>(steadyNow + (deadlineWall - wallNow), 1));
+        if (dueWall && dueWall > wallNow)
+            out.due = now + std::chrono::nanoseconds(dueWall - wallNow);
+        return out;
+    }
+
+    std::uint64_t logKill(wal::RecordType type, const std::string& taskId)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!failed_)
+        {
+            wal::RecordWriter w(buf_, type);
+            w.putString(taskId);
+            w.finish();
+        }
+        return ++appended_;
+    }
+
+    // Maps and scans `segments` in order into `live`; cuts off torn or corrupt tails.
+    void scanInto(const std::vector<Segment>& segments, std::vector<std::unique_ptr<wal::MappedFile>>& maps,
+                  wal::LiveSet& live, ReplayStats& stats)
+    {
+        std::size_t totalBytes = 0;
+        for (const Segment& s : segments) totalBytes += s.bytes;
+        live.reserve(totalBytes / 64); // a small task's Submit record is 60-80 bytes
+
+        for (const Segment& s : segments)
+        {
+            const std::string path = segmentPath(s.seq);
+            maps.push_back(std::make_unique<wal::MappedFile>(path));
+            const wal::MappedFile& m = *maps.back();
+
+            const std::size_t valid = wal::scanSegment(m.data(), m.size(), [&](wal::RecordType type, std::string_view id,
+                                                                                std::string_view record) {
+                live.apply(type, id, record);
+                ++stats.records;
+            });
+            if (valid < m.size())
+            {
+                stats.truncatedBytes += m.size() - valid;
+                if (::truncate(path.c_str(), static_cast<off_t>(valid)) != 0) failed_ = true;
+            }
+            ++stats.segments;
+        }
+    }
+
+    // Group-commit leader: writes the buffer outside the mutex. Holds `lock` on entry and exit.
+    void flushUnlocked(std::unique_lock<std::mutex>& lock)
+    {
+        flushing_ = true;
+        std::string out;
+        out.swap(buf_);
+        const std::uint64_t upto = appended_;
+        lock.unlock();
+
+        bool good = writeAll(fd_, out) && syncFd(fd_);
+        activeBytes_ += out.size();
+
+        bool rolled = false;
+        const std::size_t sealedSize = activeBytes_;
+        const std::uint64_t sealedSeq = activeSeq_;
+        if (good && activeBytes_ >= opts_.segmentBytes)
+        {
+            ::close(fd_);
+            fd_ = -1;
+            good = openSegment(activeSeq_ + 1);
+            rolled = true;
+        }
+
+        lock.lock();
+        if (rolled)
+        {
+            sealed_.push_back(Segment{sealedSeq, sealedSize});
+            sealedBytes_ += sealedSize;
+            if (opts_.compactAtBytes && sealedBytes_ >= compactAt_)
+            {
+                compactWanted_ = true;
+                maintCv_.notify_one();
+            }
+        }
+        if (!good)
+        {
+            failed_ = true;
+            std::string().swap(buf_); // appended meanwhile; never written now
+        }
+        durable_ = upto;
+        flushing_ = false;
+        flushed_.notify_all();
+    }
+
+    // Background thread: periodic flushes in async mode, and compaction.
+    void maintain()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!stop_)
+        {
+            if (opts_.flushInterval.count() > 0)
+                maintCv_.wait_for(lock, opts_.flushInterval);
+            else
+                maintCv_.wait(lock, [&] { return stop_ || compactWanted_; });
+            if (stop_) break;
+
+            if (opts_.flushInterval.count() > 0 && !flushing_ && !buf_.empty())
+                flushUnlocked(lock);
+
+            if (compactWanted_)
+            {
+                compactWanted_ = false;
+                lock.unlock();
+                compact();
+                lock.lock();
+            }
+        }
+    }
+
+    const std::string dir_;
+    const TaskLogOptions opts_;
+
+    mutable std::mutex mtx_; // buffer, sequence numbers, segment list
+    std::condition_variable flushed_;
+    std::string buf_;            // appended, not yet written
+    std::uint64_t appended_ = 0; // last record appended
+    std::uint64_t durable_ = 0;  // last record on disk
+    bool flushing_ = false;      // a leader is writing; it alone touches fd_ and active*
+    std::atomic<bool> failed_{false};
+
+    int fd_ = -1;
+    std::uint64_t activeSeq_ = 0;
+    std::size_t activeBytes_ = 0;
+
+    std::vector<Segment> sealed_; // oldest first
+    std::size_t sealedBytes_ = 0;
+    std::size_t compactAt_ = 0;
+    ReplayStats lastReplay_;
+
+    std::mutex compactMtx_; // one replay or compaction at a time
+    std::condition_variable maintCv_;
+    bool compactWanted_ = false;
+    bool stop_ = false;
+    std::thread maintenance_;
+};
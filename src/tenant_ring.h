@@ -0,0 +1,234 @@
+// tenant_ring.h
+// C++17, STL only
+//
+// Fair-by-tenant queue: the one ring FairTaskScheduler schedules from, and each of
+// PriorityTaskScheduler's bands.
+//
+// - One lane per tenant: an intrusive list over the scheduler's node pool
+//   (intrusive_task_list.h), indexed by tenant handle and kept when drained.
+// - activeRing_ holds each tenant with work at most once (inRing_).
+// - unlink() (cancel) is O(1). A lane it empties stays in the ring until its turn, then
+//   is dropped and counted as CanceledSkipped.
+// - Modes:
+//     RoundRobin        : one task per tenant turn.
+//     DeficitRoundRobin : each turn a tenant earns quantum * weight credits and runs tasks
+//                         while its credit covers Task::cost. O(1) amortized per pop as long
+//                         as quantum * weight >= typical cost.
+// - admit(tenant, handle) may refuse a tenant's head task (rate limit): the tenant is then
+//   parked, off the ring but still owning its lane, until unpark().
+// - Not thread-safe: the scheduler's lock guards it.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "id_interner.h"
+#include "intrusive_task_list.h"
+#include "scheduler_metrics.h"
+#include "slab_allocator.h"
+#include "task.h"
+
+enum class FairMode
+{
+    RoundRobin,
+    DeficitRoundRobin,
+};
+
+class TenantRing
+{
+public:
+    using Nodes = TaskNodes<Task>;
+
+    TenantRing() = default;
+    TenantRing(FairMode mode, std::uint32_t quantum) : mode_(mode), quantum_(quantum) {}
+
+    // The node for `handle` must already hold the task; its lane is the tenant handle.
+    void push(Nodes& nodes, TaskIdTable::Handle handle)
+    {
+        const IdInterner::Handle tenant = nodes[handle].lane;
+        ensureTenant(tenant);
+
+        lanes_[tenant].pushBack(nodes, handle);
+        ++size_;
+        if (!inRing_[tenant])
+        {
+            inRing_[tenant] = true;
+            activeRing_.push_back(tenant);
+        }
+    }
+
+    // O(1). An emptied lane stays in activeRing_ until its turn comes up.
+    void unlink(Nodes& nodes, TaskIdTable::Handle handle)
+    {
+        lanes_[nodes[handle].lane].unlink(nodes, handle);
+        --size_;
+    }
+
+    bool empty() const noexcept { return size_ == 0; }
+
+    std::size_t size() const noexcept { return size_; }
+
+    // False once every queued task belongs to a parked tenant (or the ring is empty).
+    // May be true for tenants drained by cancel(); popOne() skips those.
+    bool runnable() const noexcept { return !activeRing_.empty(); }
+
+    // DRR weight (clamped to >= 1); applies from the tenant's next turn.
+    void setWeight(IdInterner::Handle tenant, std::uint32_t weight)
+    {
+        ensureTenant(tenant);
+        shares_[tenant].weight = weight > 0 ? weight : 1;
+    }
+
+    // Pops one task fairly by tenant. Returns its handle, or nullopt if nothing is runnable.
+    // The task itself stays in `nodes` for the caller to move out.
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> popOne(Nodes& nodes, Admit&& admit, SchedulerMetrics& metrics)
+    {
+        return mode_ == FairMode::DeficitRoundRobin ? popDeficit(nodes, admit, metrics)
+                                                    : popRoundRobin(nodes, admit, metrics);
+    }
+
+    // Returns a parked tenant to the back of the ring (or forgets it if cancel() drained it).
+    void unpark(IdInterner::Handle tenant)
+    {
+        if (!lanes_[tenant].empty())
+            activeRing_.push_back(tenant);
+        else
+            inRing_[tenant] = false;
+    }
+
+    // Reporting: (tenant handle, queued tasks) for every tenant with work, parked or not.
+    template <typename Fn>
+    void forEachLane(Fn&& fn) const
+    {
+        for (IdInterner::Handle tenant = 0; tenant < lanes_.size(); ++tenant)
+        {
+            if (!lanes_[tenant].empty())
+                fn(tenant, lanes_[tenant].size);
+        }
+    }
+
+private:
+    struct TenantShare
+    {
+        std::uint32_t weight = 1;
+        std::uint64_t deficit = 0;
+    };
+
+    void ensureTenant(IdInterner::Handle tenant)
+    {
+        if (tenant < lanes_.size()) return;
+        lanes_.resize(tenant + 1);
+        inRing_.resize(tenant + 1, false);
+        shares_.resize(tenant + 1);
+    }
+
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> popRoundRobin(Nodes& nodes, Admit& admit, SchedulerMetrics& metrics)
+    {
+        while (!activeRing_.empty())
+        {
+            IdInterner::Handle tenant = activeRing_.front();
+            activeRing_.pop_front();
+
+            auto& lane = lanes_[tenant];
+            if (lane.empty())
+            {
+                inRing_[tenant] = false; // drained by cancel()
+                metrics.add(metrics::Counter::CanceledSkipped);
+                continue;
+            }
+
+            const TaskIdTable::Handle handle = lane.head;
+            if (!admit(tenant, handle))
+                continue; // parked: inRing_ stays set so push() won't requeue it
+
+            lane.unlink(nodes, handle);
+            --size_;
+
+            if (!lane.empty())
+                activeRing_.push_back(tenant);
+            else
+                inRing_[tenant] = false;
+
+            return handle;
+        }
+        return std::nullopt;
+    }
+
+    // The tenant at the ring head keeps its turn while its deficit covers the head task's
+    // cost; otherwise it rotates to the back and the next tenant is credited.
+    template <typename Admit>
+    std::optional<TaskIdTable::Handle> popDeficit(Nodes& nodes, Admit& admit, SchedulerMetrics& metrics)
+    {
+        while (!activeRing_.empty())
+        {
+            IdInterner::Handle tenant = activeRing_.front();
+            auto& lane = lanes_[tenant];
+            auto& share = shares_[tenant];
+
+            if (lane.empty())
+            {
+                activeRing_.pop_front();
+                inRing_[tenant] = false; // drained by cancel()
+                share.deficit = 0;       // idle tenants don't bank credit
+                headCredited_ = false;
+                metrics.add(metrics::Counter::CanceledSkipped);
+                continue;
+            }
+
+            if (!headCredited_)
+            {
+                share.deficit += static_cast<std::uint64_t>(quantum_) * share.weight;
+                headCredited_ = true;
+            }
+
+            const TaskIdTable::Handle handle = lane.head;
+            const std::uint64_t cost = std::max<std::uint32_t>(nodes[handle].task.cost, 1);
+            if (share.deficit < cost)
+            {
+                activeRing_.pop_front();
+                activeRing_.push_back(tenant);
+                headCredited_ = false;
+                continue;
+            }
+
+            if (!admit(tenant, handle))
+            {
+                activeRing_.pop_front();
+                share.deficit = 0; // parked tenants don't bank credit either
+                headCredited_ = false;
+                continue;
+            }
+
+            share.deficit -= cost;
+            lane.unlink(nodes, handle);
+            --size_;
+
+            if (lane.empty())
+            {
+                activeRing_.pop_front();
+                inRing_[tenant] = false;
+                share.deficit = 0;
+                headCredited_ = false;
+            }
+
+            return handle;
+        }
+        return std::nullopt;
+    }
+
+    FairMode mode_ = FairMode::RoundRobin;
+    std::uint32_t quantum_ = 1; // DRR credits per turn for a weight-1 tenant
+
+    std::vector<IntrusiveList> lanes_; // indexed by tenant handle; kept when drained
+    std::vector<bool> inRing_;         // indexed by tenant handle; also set while parked
+    std::vector<TenantShare> shares_;  // indexed by tenant handle; DRR only
+    bool headCredited_ = false;        // DRR: ring head already got this turn's quantum
+    std::deque<IdInterner::Handle, SlabAllocator<IdInterner::Handle>> activeRing_;
+    std::size_t size_ = 0;
+};
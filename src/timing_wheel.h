@@ -0,0 +1,234 @@
+// timing_wheel.h
+// C++17, STL only
+//
+// Hierarchical timing wheel for delayed tasks (submitAt / submitAfter).
+//
+// - 4 levels x 64 slots. Level L slot s holds items whose due tick shares every bit
+//   above level L with the current tick; they cascade one level down when the
+//   current tick enters their block. Beyond 64^4 ticks items wait in an overflow list.
+// - schedule() is O(1). advance() is O(1) amortized per item (each item cascades at
+//   most 4 times); idle stretches are skipped in one step via the occupancy bitmasks.
+// - nextDeadline() never reports a time later than the earliest due item, so a caller
+//   sleeping until then can't oversleep; at worst it wakes early at a cascade boundary.
+// - Not thread-safe: callers guard it with their own lock.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class TimingWheel
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimingWheel(Clock::duration tick = std::chrono::milliseconds(1),
+                         Clock::time_point start = Clock::now())
+        : tick_(tick), start_(start)
+    {
+    }
+
+    void schedule(T item, Clock::time_point due)
+    {
+        place(Entry{std::move(item), ceilTick(due)});
+        ++size_;
+    }
+
+    // Hands every item due at or before `now` to onExpired(T&&), in due-tick order
+    // (ties in insertion order).
+    template <typename Fn>
+    void advance(Clock::time_point now, Fn&& onExpired)
+    {
+        drain(onExpired);
+
+        const std::uint64_t target = floorTick(now);
+        while (current_ < target)
+        {
+            if (size_ == 0)
+            {
+                current_ = target;
+                break;
+            }
+
+            // Jump straight to the next tick where something can happen: an occupied
+            // level-0 slot, or the start of an occupied higher-level block (cascade).
+            current_ = std::min(nextEventTick(), target);
+            if ((current_ & kSlotMask) == 0)
+                cascade();
+            drainSlot(current_ & kSlotMask, onExpired);
+        }
+    }
+
+    std::optional<Clock::time_point> nextDeadline() const
+    {
+        if (size_ == 0) return std::nullopt;
+        if (!ready_.empty()) return toTime(current_);
+        return toTime(nextEventTick());
+    }
+
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+private:
+    static constexpr unsigned kBits = 6;
+    static constexpr unsigned kLevels = 4;
+    static constexpr std::uint64_t kSlots = std::uint64_t{1} << kBits;
+    static constexpr std::uint64_t kSlotMask = kSlots - 1;
+
+    struct Entry
+    {
+        T item;
+        std::uint64_t due; // absolute tick
+    };
+
+    static std::uint64_t lowBits(std::uint64_t n)
+    {
+        return n >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+    }
+
+    static unsigned lowestSetBit(std::uint64_t mask)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+        unsigned i = 0;
+        while (!(mask & 1)) { mask >>= 1; ++i; }
+        return i;
+#endif
+    }
+
+    // Earliest tick > current_ at which an item can expire or must cascade.
+    // Only valid when size_ > 0 and ready_ is empty.
+    std::uint64_t nextEventTick() const
+    {
+        std::uint64_t best = ~std::uint64_t{0};
+        for (unsigned level = 0; level < kLevels; ++level)
+        {
+            const unsigned shift = kBits * level;
+            const std::uint64_t cur = (current_ >> shift) & kSlotMask;
+            // Placement guarantees every occupied slot is strictly ahead of the cursor.
+            const std::uint64_t ahead = occupied_[level] & ~lowBits(cur + 1);
+            if (!ahead) continue;
+            const std::uint64_t blockBase = (current_ >> (shift + kBits)) << (shift + kBits);
+            best = std::min(best, blockBase + (static_cast<std::uint64_t>(lowestSetBit(ahead)) << shift));
+        }
+        if (!overflow_.empty())
+        {
+            const unsigned top = kBits * kLevels;
+            best = std::min(best, ((current_ >> top) + 1) << top);
+        }
+        return best;
+    }
+
+    std::uint64_t floorTick(Clock::time_point tp) const
+    {
+        if (tp <= start_) return 0;
+        return static_cast<std::uint64_t>((tp - start_) / tick_);
+    }
+
+    std::uint64_t ceilTick(Clock::time_point tp) const
+    {
+        if (tp <= start_) return 0;
+        const auto d = tp - start_;
+        auto ticks = static_cast<std::uint64_t>(d / tick_);
+        if (d % tick_ != Clock::duration::zero()) ++ticks;
+        return ticks;
+    }
+
+    Clock::time_point toTime(std::uint64_t tick) const
+    {
+        return start_ + tick_ * static_cast<Clock::duration::rep>(tick);
+    }
+
+    void place(Entry e)
+    {
+        if (e.due <= current_)
+        {
+            ready_.push_back(std::move(e));
+            return;
+        }
+
+        for (unsigned level = 0; level < kLevels; ++level)
+        {
+            const unsigned parentShift = kBits * (level + 1);
+            if ((e.due >> parentShift) == (current_ >> parentShift))
+            {
+                const std::size_t slot = (e.due >> (kBits * level)) & kSlotMask;
+                slots_[level][slot].push_back(std::move(e));
+                occupied_[level] |= std::uint64_t{1} << slot;
+                return;
+            }
+        }
+        overflow_.push_back(std::move(e));
+    }
+
+    // current_ just crossed a 64-tick boundary: pull the matching higher-level slots down.
+    void cascade()
+    {
+        for (unsigned level = 1; level < kLevels; ++level)
+        {
+            const unsigned shift = kBits * level;
+            redistribute(level, (current_ >> shift) & kSlotMask);
+            if (((current_ >> shift) & kSlotMask) != 0)
+                return;
+        }
+
+        std::vector<Entry> far;
+        far.swap(overflow_);
+        for (Entry& e : far)
+            place(std::move(e));
+    }
+
+    void redistribute(unsigned level, std::size_t slot)
+    {
+        if (!(occupied_[level] & (std::uint64_t{1} << slot))) return;
+
+        std::vector<Entry> moving;
+        moving.swap(slots_[level][slot]);
+        occupied_[level] &= ~(std::uint64_t{1} << slot);
+        for (Entry& e : moving)
+            place(std::move(e));
+    }
+
+    template <typename Fn>
+    void drainSlot(std::size_t slot, Fn& onExpired)
+    {
+        if (occupied_[0] & (std::uint64_t{1} << slot))
+        {
+            ready_.insert(ready_.end(),
+                          std::make_move_iterator(slots_[0][slot].begin()),
+                          std::make_move_iterator(slots_[0][slot].end()));
+            slots_[0][slot].clear();
+            occupied_[0] &= ~(std::uint64_t{1} << slot);
+        }
+        drain(onExpired);
+    }
+
+    template <typename Fn>
+    void drain(Fn& onExpired)
+    {
+        if (ready_.empty()) return;
+        std::vector<Entry> out;
+        out.swap(ready_);
+        size_ -= out.size();
+        for (Entry& e : out)
+            onExpired(std::move(e.item));
+    }
+
+private:
+    Clock::duration tick_;
+    Clock::time_point start_;
+    std::uint64_t current_ = 0;
+    std::size_t size_ = 0;
+
+    std::array<std::array<std::vector<Entry>, kSlots>, kLevels> slots_{};
+    std::array<std::uint64_t, kLevels> occupied_{};
+    std::vector<Entry> overflow_;
+    std::vector<Entry> ready_; // due at or before current_
+};
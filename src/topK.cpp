@@ -11,7 +11,7 @@ vector<int> topK(const vector<int> &nums, int k)
     for (int x : nums)
     {
         pq.push(x);
-        if (pq.size() > k)
+        if (pq.size() > static_cast<size_t>(k))
         {
             pq.pop();
         }
@@ -0,0 +1,208 @@
+// wait_policy.h
+// C++17, STL only
+//
+// How idle workers sleep and get woken: the WaitPolicy of Scheduler (scheduler_core.h).
+// sleep() is entered with the scheduler lock held and returns with it held; notify*()
+// are called after the lock is released, so a woken worker never wakes into a held lock.
+//
+//   CondVarWait      : one condition variable shared by all workers. Every sleep is a
+//                      context switch; every wake-up one futex call.
+//   SpinThenParkWait : a worker first spins (lock released) watching a wake-up epoch, so
+//                      work that arrives within the spin window costs neither side a
+//                      syscall. Only then does it park, on its own condition variable:
+//                      - a notify claims a spinning worker if there is one, and only
+//                        otherwise wakes a parked one; it never wakes more than asked,
+//                      - parked workers wake LIFO, so the most recently idle (warmest
+//                        cache) runs next and long-idle ones stay asleep,
+//                      - a notify with nobody spinning or parked is two atomic operations.
+//                      The spin budget adapts (AdaptiveSpinner): it grows while spins find
+//                      work and shrinks while they end in a park.
+//
+// AdaptiveSpinner is also used by the lock-free FIFO backends (fifo_scheduler.h).
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Spin budget that grows when spinning finds work and shrinks when it ends in a park,
+// so idle workers stop burning CPU and busy ones stop paying for context switches.
+class AdaptiveSpinner
+{
+public:
+    int budget() const noexcept { return budget_.load(std::memory_order_relaxed); }
+
+    void onSpinHit() noexcept
+    {
+        int b = budget();
+        if (b < kMaxSpin) budget_.store(b * 2, std::memory_order_relaxed);
+    }
+
+    void onPark() noexcept
+    {
+        int b = budget();
+        if (b > kMinSpin) budget_.store(b / 2, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int kMinSpin = 4;
+    static constexpr int kMaxSpin = 1024;
+    std::atomic<int> budget_{64};
+};
+
+class CondVarWait
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Releases `lock` while asleep. Returns on notify, at `deadline`, or spuriously.
+    void sleep(std::unique_lock<std::mutex>& lock, std::optional<Clock::time_point> deadline)
+    {
+        if (deadline) cv_.wait_until(lock, *deadline);
+        else cv_.wait(lock);
+    }
+
+    void notifyOne() { cv_.notify_one(); }
+    void notifyAll() { cv_.notify_all(); }
+
+    // Wake at most `n` of `idle` sleepers; waking more would just have them find nothing.
+    void notifyUpTo(std::size_t n, std::size_t idle)
+    {
+        if (n >= idle) cv_.notify_all();
+        else while (n--) cv_.notify_one();
+    }
+
+private:
+    std::condition_variable cv_;
+};
+
+class SpinThenParkWait
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Releases `lock` while spinning or parked. Returns on notify, at `deadline`, or
+    // spuriously (a notify meant for another worker).
+    void sleep(std::unique_lock<std::mutex>& lock, std::optional<Clock::time_point> deadline)
+    {
+        // Read under the scheduler lock: any notify for work this worker didn't see comes later.
+        const std::uint64_t seen = epoch_.load(std::memory_order_seq_cst);
+        lock.unlock();
+        if (!spin(seen, deadline))
+            park(seen, deadline);
+        lock.lock();
+    }
+
+    void notifyOne() { wake(1); }
+    void notifyAll() { wake(std::numeric_limits<std::size_t>::max()); }
+
+    // `idle` is not needed: this policy knows exactly who is spinning and who is parked.
+    void notifyUpTo(std::size_t n, std::size_t) { wake(n); }
+
+private:
+    struct Waiter
+    {
+        std::condition_variable cv;
+        bool woken = false; // guarded by parkMtx_
+    };
+
+    // Returns true if this worker should go back and look for work: a notify arrived
+    // (or claimed it), or the deadline passed. False: park.
+    bool spin(std::uint64_t seen, std::optional<Clock::time_point> deadline)
+    {
+        unclaimed_.fetch_add(1, std::memory_order_seq_cst);
+
+        bool hit = false;
+        for (int i = 0, n = spinner_.budget(); i < n; ++i)
+        {
+            if (epoch_.load(std::memory_order_seq_cst) != seen)
+            {
+                hit = true;
+                break;
+            }
+            if (deadline && Clock::now() >= *deadline) break;
+            std::this_thread::yield();
+        }
+
+        // Give the spinning slot back. If a notifier already took it, that notify was
+        // counted on this worker: don't park.
+        if (!tryTake(unclaimed_)) hit = true;
+
+        if (hit) spinner_.onSpinHit();
+        else spinner_.onPark();
+        return hit || (deadline && Clock::now() >= *deadline);
+    }
+
+    void park(std::uint64_t seen, std::optional<Clock::time_point> deadline)
+    {
+        Waiter self;
+        std::unique_lock<std::mutex> lock(parkMtx_);
+        parked_.push_back(&self);
+        parkedCount_.fetch_add(1, std::memory_order_seq_cst);
+
+        // wake() bumps epoch_ before it looks at parkedCount_, so either it sees this
+        // worker parked or this check sees its bump.
+        if (epoch_.load(std::memory_order_seq_cst) == seen)
+        {
+            auto woken = [&] { return self.woken; };
+            if (deadline) self.cv.wait_until(lock, *deadline, woken);
+            else self.cv.wait(lock, woken);
+        }
+
+        if (!self.woken)
+        {
+            // Left on its own (deadline or a late epoch bump): still on the stack.
+            parked_.erase(std::find(parked_.begin(), parked_.end(), &self));
+            parkedCount_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    void wake(std::size_t n)
+    {
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+
+        // Spinning workers see the bump by themselves; claim one per wake-up first.
+        while (n > 0 && tryTake(unclaimed_)) --n;
+        if (n == 0 || parkedCount_.load(std::memory_order_seq_cst) == 0) return;
+
+        std::lock_guard<std::mutex> lock(parkMtx_);
+        while (n > 0 && !parked_.empty())
+        {
+            Waiter* w = parked_.back();
+            parked_.pop_back();
+            parkedCount_.fetch_sub(1, std::memory_order_relaxed);
+            w->woken = true;
+            w->cv.notify_one(); // under parkMtx_: the waiter can't return (and destroy w) first
+            --n;
+        }
+    }
+
+    // Decrements `counter` if it is positive.
+    static bool tryTake(std::atomic<std::size_t>& counter)
+    {
+        std::size_t c = counter.load(std::memory_order_seq_cst);
+        while (c > 0)
+        {
+            if (counter.compare_exchange_weak(c, c - 1, std::memory_order_seq_cst))
+                return true;
+        }
+        return false;
+    }
+
+    std::atomic<std::uint64_t> epoch_{0};     // bumped by every notify
+    std::atomic<std::size_t> unclaimed_{0};   // spinning workers no notify has claimed yet
+    std::atomic<std::size_t> parkedCount_{0}; // parked_.size(), readable without parkMtx_
+    AdaptiveSpinner spinner_;
+
+    std::mutex parkMtx_; // never held while taking the scheduler lock
+    std::vector<Waiter*> parked_; // LIFO
+};
@@ -0,0 +1,921 @@
+// scheduler_tests.cpp
+// C++17, STL + POSIX (task_log.h, shm_task_queue.h, fork)
+//
+// Assertion tests for the scheduler library. Most tests are single-threaded and
+// deterministic; the clock only matters where a test sleeps past a small, fixed step.
+// Concurrent tests check invariants that must hold under any interleaving.
+// Built as C++20 as well (scheduler_tests_cxx20), which adds the coroutine consumers.
+//
+//   ./scheduler_tests            run every test
+//   ./scheduler_tests wal        run the tests whose name contains "wal"
+//
+// CHECK reports file:line and keeps going; the exit status is 1 if any test failed, so
+// ctest sees it. Works with NDEBUG, unlike assert.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "coro_scheduler.h"
+#include "fair_scheduler.h"
+#include "fifo_scheduler.h"
+#include "priority_scheduler.h"
+#include "shm_task_queue.h"
+#include "task_log.h"
+
+namespace
+{
+
+int failures = 0;
+
+#define CHECK(cond)                                                                       \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(cond))                                                                      \
+        {                                                                                 \
+            std::cerr << "  " << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed\n"; \
+            ++failures;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+Task makeTask(const std::string& id, const std::string& tenant = "t", int priority = 0, std::uint32_t cost = 1)
+{
+    Task t;
+    t.task_id = id;
+    t.tenant_id = tenant;
+    t.priority = priority;
+    t.cost = cost;
+    return t;
+}
+
+// Pops everything left, concatenating the task IDs with ',' after each.
+template <typename Sched>
+std::string drainIds(Sched& s)
+{
+    std::string ids;
+    while (auto t = s.tryGetNext()) ids += t->task_id + ",";
+    return ids;
+}
+
+// --------- FIFO ---------
+
+void fifoOrderPerBackend()
+{
+    for (FifoBackend backend : {FifoBackend::SingleQueue, FifoBackend::WorkStealing, FifoBackend::Ring})
+    {
+        FifoTaskScheduler s(FifoOptions{backend, 4, 64});
+        std::string want;
+        for (int i = 0; i < 40; ++i)
+        {
+            CHECK(s.submit(makeTask("t" + std::to_string(i))));
+            want += "t" + std::to_string(i) + ",";
+        }
+        CHECK(s.size() == 40);
+        CHECK(drainIds(s) == want);
+        CHECK(s.empty());
+
+        Task batch[3] = {makeTask("b0"), makeTask("b1"), makeTask("b2")};
+        CHECK(s.submitBatch(batch, 3) == 3);
+        CHECK(s.submit(makeTask("b3")));
+        CHECK(drainIds(s) == "b0,b1,b2,b3,");
+
+        s.shutdown();
+        CHECK(!s.submit(makeTask("late")));
+    }
+}
+
+void fifoCancelSize()
+{
+    FifoTaskScheduler s;
+    for (int i = 0; i < 10; ++i) s.submit(makeTask("t" + std::to_string(i)));
+    CHECK(s.cancel("t3"));
+    CHECK(!s.cancel("t3"));
+    CHECK(!s.cancel("missing"));
+    CHECK(s.size() == 9);
+    for (int i = 0; i < 10; i += 2) CHECK(s.cancel("t" + std::to_string(i)));
+    CHECK(s.size() == 4);
+    CHECK(drainIds(s) == "t1,t5,t7,t9,");
+    CHECK(s.empty() && s.size() == 0);
+
+    // A canceled ID can be submitted again.
+    CHECK(s.submit(makeTask("t3")));
+    CHECK(s.size() == 1);
+    CHECK(drainIds(s) == "t3,");
+}
+
+// Stealing backend, concurrently: size() counts a task before it can be popped, so a
+// sampler never sees it wrap below zero (a huge value) or exceed what was submitted.
+void stealingSizeNeverWraps()
+{
+    constexpr int kProducers = 2, kConsumers = 2, kPerProducer = 20000;
+    FifoTaskScheduler s(FifoOptions{FifoBackend::WorkStealing, 4, 0});
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> worst{0}, popped{0};
+
+    std::thread sampler([&] {
+        while (!done.load())
+        {
+            const std::size_t n = s.size();
+            if (n > worst.load()) worst.store(n);
+        }
+    });
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < kConsumers; ++c)
+        consumers.emplace_back([&] {
+            while (s.getNext()) popped.fetch_add(1);
+        });
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < kPerProducer; ++i)
+                s.submit(makeTask(std::to_string(p) + "-" + std::to_string(i)));
+        });
+    for (auto& t : producers) t.join();
+    while (!s.empty()) std::this_thread::yield();
+    s.shutdown();
+    for (auto& t : consumers) t.join();
+    done = true;
+    sampler.join();
+
+    CHECK(popped.load() == std::size_t{kProducers} * kPerProducer);
+    CHECK(worst.load() <= std::size_t{kProducers} * kPerProducer);
+    CHECK(s.size() == 0);
+}
+
+// Every backend, concurrently: producers mix submit() and submitBatch(), consumers mix
+// getNext() and getNextBatch(). Each task is delivered exactly once and, on the backends
+// with one global order, each consumer sees every producer's tasks in submit order. The
+// small ring makes producers block on a full ring too.
+void fifoStressPerBackend()
+{
+    constexpr int kProducers = 3, kConsumers = 3, kPerProducer = 6000, kBatch = 8;
+    for (FifoBackend backend : {FifoBackend::SingleQueue, FifoBackend::WorkStealing, FifoBackend::Ring})
+    {
+        FifoTaskScheduler s(FifoOptions{backend, 4, 64});
+        std::vector<std::vector<int>> seen(kProducers * kPerProducer);
+        std::vector<std::atomic<int>> delivered(kProducers * kPerProducer);
+        std::atomic<int> outOfOrder{0};
+
+        std::vector<std::thread> consumers;
+        for (int c = 0; c < kConsumers; ++c)
+            consumers.emplace_back([&, c] {
+                std::vector<int> last(kProducers, -1);
+                auto take = [&](const Task& t) {
+                    const int id = std::stoi(t.task_id);
+                    delivered[id].fetch_add(1);
+                    const int p = id / kPerProducer, seq = id % kPerProducer;
+                    if (seq <= last[p]) outOfOrder.fetch_add(1);
+                    last[p] = seq;
+                };
+                std::vector<Task> batch;
+                for (bool useBatch = c % 2 == 0;; useBatch = !useBatch)
+                {
+                    if (useBatch)
+                    {
+                        batch.clear();
+                        if (s.getNextBatch(4, batch) == 0) return;
+                        for (const Task& t : batch) take(t);
+                    }
+                    else
+                    {
+                        auto t = s.getNext();
+                        if (!t) return;
+                        take(*t);
+                    }
+                }
+            });
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p)
+            producers.emplace_back([&, p] {
+                int i = 0;
+                while (i < kPerProducer)
+                {
+                    if (i % (4 * kBatch) == 0 && i + kBatch <= kPerProducer)
+                    {
+                        Task batch[kBatch];
+                        for (int b = 0; b < kBatch; ++b) batch[b] = makeTask(std::to_string(p * kPerProducer + i + b));
+                        s.submitBatch(batch, kBatch);
+                        i += kBatch;
+                    }
+                    else
+                    {
+                        s.submit(makeTask(std::to_string(p * kPerProducer + i)));
+                        ++i;
+                    }
+                }
+            });
+        for (auto& t : producers) t.join();
+        while (!s.empty()) std::this_thread::yield();
+        s.shutdown();
+        for (auto& t : consumers) t.join();
+
+        int once = 0;
+        for (auto& d : delivered) once += d.load() == 1;
+        CHECK(once == kProducers * kPerProducer);
+        if (backend != FifoBackend::WorkStealing) CHECK(outOfOrder.load() == 0);
+#ifndef SCHED_NO_METRICS
+        const metrics::Snapshot snap = s.metricsSnapshot();
+        CHECK(snap[metrics::Counter::Submitted] == std::uint64_t{kProducers} * kPerProducer);
+        CHECK(snap[metrics::Counter::Dequeued] == std::uint64_t{kProducers} * kPerProducer);
+#endif
+    }
+}
+
+// Delayed tasks on every backend (timing wheel on SingleQueue, feeder thread otherwise):
+// none shows up before its due time, they come out in due order, and shutdown wakes a
+// worker blocked on a far-off one.
+void delayedRelease()
+{
+    using Clock = std::chrono::steady_clock;
+    using std::chrono::milliseconds;
+    for (FifoBackend backend : {FifoBackend::SingleQueue, FifoBackend::WorkStealing, FifoBackend::Ring})
+    {
+        FifoTaskScheduler s(FifoOptions{backend, 2, 64});
+        const Clock::time_point start = Clock::now();
+        CHECK(s.submitAt(makeTask("d30"), start + milliseconds(30)));
+        CHECK(s.submitAt(makeTask("d10"), start + milliseconds(10)));
+        CHECK(s.submitAt(makeTask("d20"), start + milliseconds(20)));
+        CHECK(s.submit(makeTask("now")));
+
+        std::string order;
+        bool early = false;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto t = s.getNext();
+            if (!t) break;
+            order += t->task_id + ",";
+            if (t->task_id != "now")
+                early |= Clock::now() < start + milliseconds(std::stoi(t->task_id.substr(1)));
+        }
+        CHECK(order == "now,d10,d20,d30,");
+        CHECK(!early);
+
+        CHECK(s.submitAfter(makeTask("never"), std::chrono::hours(1)));
+        std::atomic<bool> woke{false};
+        std::thread worker([&] {
+            CHECK(!s.getNext());
+            woke = true;
+        });
+        std::this_thread::sleep_for(milliseconds(5));
+        CHECK(!woke.load());
+        s.shutdown();
+        worker.join();
+        CHECK(woke.load());
+    }
+}
+
+// --------- Fair ---------
+
+void fairCancelSize()
+{
+    FairTaskScheduler s;
+    for (int i = 0; i < 10; ++i) s.submit(makeTask("t" + std::to_string(i), i % 2 ? "A" : "B"));
+    CHECK(s.size() == 10);
+    CHECK(s.cancel("t3"));
+    CHECK(!s.cancel("t3"));
+    CHECK(s.size() == 9);
+    // Emptying tenant B's lane entirely must leave size() and empty() exact.
+    for (int i = 0; i < 10; i += 2) CHECK(s.cancel("t" + std::to_string(i)));
+    CHECK(s.size() == 4);
+    CHECK(drainIds(s) == "t1,t5,t7,t9,");
+    CHECK(s.empty());
+}
+
+void fairRoundRobin()
+{
+    FairTaskScheduler s;
+    for (int i = 0; i < 3; ++i) s.submit(makeTask("a" + std::to_string(i), "A"));
+    s.submit(makeTask("b0", "B"));
+    s.submit(makeTask("c0", "C"));
+    CHECK(drainIds(s) == "a0,b0,c0,a1,a2,");
+}
+
+void fairDrrWeights()
+{
+    // Weight 3 earns tenant A three quanta per turn: over whole rounds A gets three times
+    // B's and C's credits, whatever their task costs.
+    FairTaskScheduler s(FairOptions{FairMode::DeficitRoundRobin, 10});
+    s.setTenantWeight("A", 3);
+    for (int i = 0; i < 300; ++i)
+    {
+        s.submit(makeTask("a" + std::to_string(i), "A", 0, 5));
+        s.submit(makeTask("b" + std::to_string(i), "B", 0, 5));
+        s.submit(makeTask("c" + std::to_string(i), "C", 0, 10));
+    }
+
+    // One round: A spends 30 credits, B and C 10 each.
+    std::map<std::string, std::uint32_t> spent;
+    for (int i = 0; i < 6 + 2 + 1; ++i)
+    {
+        auto t = s.tryGetNext();
+        CHECK(t.has_value());
+        if (t) spent[t->tenant_id] += t->cost;
+    }
+    CHECK(spent["A"] == 30);
+    CHECK(spent["B"] == 10);
+    CHECK(spent["C"] == 10);
+
+    // Ten more rounds keep the 3:1:1 split exactly.
+    spent.clear();
+    for (int i = 0; i < 10 * 9; ++i)
+    {
+        auto t = s.tryGetNext();
+        if (t) spent[t->tenant_id] += t->cost;
+    }
+    CHECK(spent["A"] == 300);
+    CHECK(spent["B"] == 100);
+    CHECK(spent["C"] == 100);
+}
+
+// A rate-limited tenant is parked once its bucket is empty, the others keep running, and
+// it comes back at its refill time; removing the limit unparks it at once.
+void rateLimitParksTenant()
+{
+    using Clock = std::chrono::steady_clock;
+    FairTaskScheduler s;
+    s.setTenantRateLimit("slow", RateLimit{50, 1}); // one token per 20ms
+    for (int i = 0; i < 3; ++i)
+    {
+        s.submit(makeTask("s" + std::to_string(i), "slow"));
+        s.submit(makeTask("f" + std::to_string(i), "fast"));
+    }
+
+    CHECK(drainIds(s) == "s0,f0,f1,f2,");
+    CHECK(s.size() == 2);
+
+    const Clock::time_point parkedAt = Clock::now();
+    auto t = s.getNext();
+    CHECK(t && t->task_id == "s1");
+    CHECK(Clock::now() - parkedAt >= std::chrono::milliseconds(10));
+
+    CHECK(!s.tryGetNext());
+    s.setTenantRateLimit("slow", RateLimit{});
+    CHECK(drainIds(s) == "s2,");
+#ifndef SCHED_NO_METRICS
+    CHECK(s.metricsSnapshot()[metrics::Counter::TenantsParked] >= 2);
+#endif
+}
+
+// --------- Priority / deadline ---------
+
+void priorityCancelSize()
+{
+    PriorityTaskScheduler<3> s;
+    for (int i = 0; i < 9; ++i) s.submit(makeTask("t" + std::to_string(i), "t", i % 3));
+    CHECK(s.size() == 9);
+    CHECK(s.cancel("t0"));
+    CHECK(s.cancel("t3"));
+    CHECK(s.cancel("t6"));
+    CHECK(!s.cancel("t6"));
+    CHECK(s.size() == 6);
+    std::size_t popped = 0;
+    while (auto t = s.tryGetNext())
+    {
+        CHECK(t->priority != 0); // every P0 task was canceled
+        ++popped;
+    }
+    CHECK(popped == 6);
+    CHECK(s.empty());
+}
+
+void edfOrder()
+{
+    DeadlineOptions<3> o = defaultDeadlineOptions<3>();
+    o.agingStep = std::chrono::nanoseconds(0);
+    DeadlineTaskScheduler<3> s(o);
+
+    const auto now = std::chrono::steady_clock::now();
+    Task late = makeTask("late", "t", 1);
+    late.deadline = deadlineAt(now + std::chrono::milliseconds(50));
+    Task soon = makeTask("soon", "t", 1);
+    soon.deadline = deadlineAt(now + std::chrono::milliseconds(5));
+    s.submit(late);
+    s.submit(soon);
+    s.submit(makeTask("p0", "t", 0));
+    s.submit(makeTask("p2", "t", 2));
+    s.submit(makeTask("gone", "t", 0));
+    CHECK(s.cancel("gone"));
+    CHECK(s.size() == 4);
+
+    // Band first, then earliest deadline within the band.
+    CHECK(drainIds(s) == "p0,soon,late,p2,");
+}
+
+void edfAging()
+{
+    DeadlineOptions<3> o = defaultDeadlineOptions<3>();
+    o.agingStep = std::chrono::milliseconds(2);
+    DeadlineTaskScheduler<3> s(o);
+
+    const auto hourOut = deadlineAt(std::chrono::steady_clock::now() + std::chrono::hours(1));
+    s.submit(makeTask("low", "t", 2));
+    for (const char* id : {"p0a", "p0b"})
+    {
+        Task t = makeTask(id, "t", 0);
+        t.deadline = hourOut;
+        s.submit(t);
+    }
+
+    // No pop while the P2 task waits two steps: the next pop still finds it in P0, with a
+    // deadline of at most (submit + 2 steps) + slack[0]. That is ahead of P0 work due in an
+    // hour, and of a P0 task submitted now with the default slack.
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    s.submit(makeTask("fresh", "t", 0));
+    CHECK(drainIds(s) == "low,fresh,p0a,p0b,");
+#ifndef SCHED_NO_METRICS
+    CHECK(s.metricsSnapshot()[metrics::Counter::Promoted] == 2);
+#endif
+}
+
+// --------- Retries ---------
+
+void retryToDeadLetter()
+{
+    FairTaskScheduler s;
+    s.setRetryPolicy(RetryPolicy{3, std::chrono::milliseconds(1), std::chrono::milliseconds(2)});
+    s.submit(makeTask("flaky"));
+
+    for (std::uint32_t attempt = 0; attempt < 3; ++attempt)
+    {
+        auto t = s.getNext(); // waits out the backoff of the previous failure
+        CHECK(t && t->task_id == "flaky" && t->attempt == attempt);
+        CHECK(s.fail("flaky"));
+        CHECK(!s.fail("flaky")); // no longer in flight
+    }
+
+    CHECK(s.deadLetterSize() == 1);
+    CHECK(s.delayedSize() == 0);
+    CHECK(!s.tryGetNext());
+    std::vector<Task> dead = s.drainDeadLetters();
+    CHECK(dead.size() == 1 && dead[0].task_id == "flaky" && dead[0].attempt == 3);
+    CHECK(s.deadLetterSize() == 0);
+    CHECK(!s.complete("flaky"));
+}
+
+// --------- Write-ahead log ---------
+
+void walReplayAfterTruncation()
+{
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "scheduler_tests_wal";
+    fs::remove_all(dir);
+
+    {
+        auto log = TaskLog::open(dir.string());
+        CHECK(log != nullptr);
+        if (!log) return;
+        FairTaskScheduler s;
+        CHECK(s.attachLog(*log) == 0);
+        for (const char* id : {"a", "b", "c", "d", "e"}) CHECK(s.submit(makeTask(id)));
+        CHECK(s.cancel("b"));
+        auto a = s.tryGetNext();
+        CHECK(a && a->task_id == "a");
+        s.complete("a"); // logged even without a retry policy, which is what tracks in-flight tasks
+        CHECK(s.submit(makeTask("torn"))); // last record: cut in half below
+    }
+
+    // A crash mid-write: chop the tail off the newest segment.
+    fs::path newest;
+    for (const auto& entry : fs::directory_iterator(dir))
+        if (newest.empty() || entry.path().filename() > newest.filename()) newest = entry.path();
+    CHECK(!newest.empty());
+    const auto bytes = fs::file_size(newest);
+    fs::resize_file(newest, bytes - 3);
+
+    {
+        auto log = TaskLog::open(dir.string());
+        CHECK(log != nullptr);
+        if (!log) return;
+        FairTaskScheduler s;
+        CHECK(s.attachLog(*log) == 3);
+        CHECK(log->lastReplay().truncatedBytes > 0);
+        CHECK(drainIds(s) == "c,d,e,");
+    }
+
+    // The torn record is gone for good: a third open sees the same live set, nothing cut.
+    {
+        auto log = TaskLog::open(dir.string());
+        FairTaskScheduler s;
+        CHECK(s.attachLog(*log) == 3);
+        CHECK(log->lastReplay().truncatedBytes == 0);
+    }
+    fs::remove_all(dir);
+}
+
+// IDs of the live tasks a fresh open of `dir` replays, in replay order.
+std::string replayIds(const std::string& dir)
+{
+    auto log = TaskLog::open(dir);
+    CHECK(log != nullptr);
+    std::string ids;
+    if (log) log->replay([](std::size_t) {}, [&](TaskLog::Recovered&& r) { ids += r.task.task_id + ","; });
+    return ids;
+}
+
+void walCompactionCrash()
+{
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "scheduler_tests_compact";
+    fs::remove_all(dir);
+
+    // Every open seals the previous segment: Submit A and B land in segment 1, Complete A
+    // and Submit C in segment 2.
+    {
+        auto log = TaskLog::open(dir.string());
+        CHECK(log != nullptr);
+        if (!log) return;
+        log->logSubmit(makeTask("A"));
+        log->logSubmit(makeTask("B"));
+        CHECK(log->flush());
+    }
+    {
+        auto log = TaskLog::open(dir.string());
+        log->logComplete("A");
+        log->logSubmit(makeTask("C"));
+        CHECK(log->flush());
+    }
+
+    // Compact, then put back every segment it deleted, as a crash right after the rename
+    // would leave them.
+    std::map<fs::path, std::string> before;
+    for (const auto& entry : fs::directory_iterator(dir))
+    {
+        std::ifstream in(entry.path(), std::ios::binary);
+        before[entry.path()].assign(std::istreambuf_iterator<char>(in), {});
+    }
+    {
+        auto log = TaskLog::open(dir.string());
+        CHECK(log->compact());
+    }
+    std::size_t restored = 0;
+    for (const auto& [path, bytes] : before)
+    {
+        if (fs::exists(path)) continue;
+        std::ofstream(path, std::ios::binary) << bytes;
+        ++restored;
+    }
+    CHECK(restored > 0);
+
+    // A was completed: it must not come back, whichever old segments survived.
+    CHECK(replayIds(dir.string()) == "B,C,");
+    fs::remove_all(dir);
+}
+
+// A log whose records never reach disk.
+struct FailingLog final : DurableLog
+{
+    struct Recovered
+    {
+        Task task;
+        std::optional<Clock::time_point> due;
+    };
+
+    template <typename Reserve, typename OnTask>
+    void replay(Reserve&& reserve, OnTask&&)
+    {
+        reserve(0);
+    }
+
+    std::uint64_t lsn = 0;
+    std::uint64_t logSubmit(const Task&, std::optional<Clock::time_point>) override { return ++lsn; }
+    std::uint64_t logSubmitBatch(const Task*, std::size_t count) override { return lsn += count; }
+    std::uint64_t logCancel(const std::string&) override { return ++lsn; }
+    std::uint64_t logComplete(const std::string&) override { return ++lsn; }
+    bool waitDurable(std::uint64_t) override { return false; }
+};
+
+void walFailureReported()
+{
+    FailingLog log;
+    FifoTaskScheduler s;
+    CHECK(s.attachLog(log) == std::optional<std::size_t>(0));
+    CHECK(!s.submit(makeTask("a"))); // not durable, but queued
+    Task batch[2] = {makeTask("b"), makeTask("c")};
+    CHECK(s.submitBatch(batch, 2) == 0);
+    CHECK(s.size() == 3);
+    CHECK(!s.cancel("a")); // not durable, but canceled
+    CHECK(s.size() == 2);
+#ifndef SCHED_NO_METRICS
+    CHECK(s.metricsSnapshot()[metrics::Counter::NotDurable] == 3);
+#endif
+}
+
+// A TaskLog whose writes failed drops later appends instead of buffering them forever,
+// in both modes. Failure here: the directory is gone when the first segment rolls.
+void walFailureStopsBuffering()
+{
+    namespace fs = std::filesystem;
+    for (auto interval : {std::chrono::milliseconds(0), std::chrono::milliseconds(1)})
+    {
+        const fs::path dir = fs::temp_directory_path() / "scheduler_tests_wal_failed";
+        fs::remove_all(dir);
+        TaskLogOptions opts;
+        opts.segmentBytes = 1;
+        opts.flushInterval = interval;
+        auto log = TaskLog::open(dir.string(), opts);
+        CHECK(log);
+        if (!log) continue;
+        fs::remove_all(dir);
+
+        log->logSubmit(makeTask("a"));
+        CHECK(!log->flush());
+        CHECK(!log->ok());
+        for (int i = 0; i < 1000; ++i)
+        {
+            const std::uint64_t lsn = log->logSubmit(makeTask("t" + std::to_string(i)));
+            log->logComplete("t" + std::to_string(i));
+            CHECK(!log->waitDurable(lsn));
+        }
+        CHECK(log->bufferedBytes() == 0);
+    }
+}
+
+// --------- Dependencies ---------
+
+void dependencyRelease()
+{
+    FairTaskScheduler s;
+    CHECK(s.submit(makeTask("A"), {}));
+    CHECK(s.submit(makeTask("B"), {"A"}));
+    CHECK(s.submit(makeTask("C"), {"A", "B"}));
+    CHECK(s.size() == 1 && s.blockedSize() == 2);
+
+    CHECK(drainIds(s) == "A,");
+    s.complete("A");
+    CHECK(s.blockedSize() == 1);
+    CHECK(drainIds(s) == "B,");
+    s.complete("B");
+    CHECK(drainIds(s) == "C,");
+    s.complete("C");
+    CHECK(s.blockedSize() == 0 && s.empty());
+
+    // Canceling a dep drops its blocked dependents, transitively.
+    CHECK(s.submit(makeTask("x"), {}));
+    CHECK(s.submit(makeTask("y"), {"x"}));
+    CHECK(s.submit(makeTask("z"), {"y"}));
+    CHECK(s.cancel("x"));
+    CHECK(s.size() == 0 && s.blockedSize() == 0);
+}
+
+void completeBeforeDispatch()
+{
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "scheduler_tests_early";
+    fs::remove_all(dir);
+    {
+        auto log = TaskLog::open(dir.string());
+        CHECK(log != nullptr);
+        if (!log) return;
+        FairTaskScheduler s;
+        s.attachLog(*log);
+        CHECK(s.submit(makeTask("A"), {}));
+        CHECK(s.submit(makeTask("B"), {"A"}));
+
+        // A is still queued: reports on it change nothing.
+        CHECK(!s.complete("A"));
+        CHECK(!s.fail("A"));
+        CHECK(s.size() == 1 && s.blockedSize() == 1);
+    }
+    // Neither report was logged as A's end, so a restart still has A (B isn't logged
+    // until released).
+    CHECK(replayIds(dir.string()) == "A,");
+
+    // Same with a retry policy tracking dispatched tasks.
+    FairTaskScheduler s;
+    s.setRetryPolicy(RetryPolicy{3, std::chrono::milliseconds(1), std::chrono::milliseconds(1)});
+    CHECK(s.submit(makeTask("A"), {}));
+    CHECK(s.submit(makeTask("B"), {"A"}));
+    CHECK(!s.complete("A"));
+    CHECK(s.blockedSize() == 1);
+    CHECK(drainIds(s) == "A,");
+    CHECK(s.complete("A"));
+    CHECK(drainIds(s) == "B,");
+    fs::remove_all(dir);
+}
+
+void dependencyCycleRejected()
+{
+    FairTaskScheduler s;
+    CHECK(!s.submit(makeTask("self"), {"self"}));
+
+    std::vector<DependentTask> cycle{{makeTask("p"), {"q"}}, {makeTask("q"), {"r"}}, {makeTask("r"), {"p"}}};
+    CHECK(!s.submitGraph(cycle));
+    CHECK(s.size() == 0 && s.blockedSize() == 0); // all or nothing
+
+    // Forward references within a batch are fine.
+    std::vector<DependentTask> chain{{makeTask("z"), {"y"}}, {makeTask("y"), {"x"}}, {makeTask("x"), {}}};
+    CHECK(s.submitGraph(chain));
+    CHECK(s.size() == 1 && s.blockedSize() == 2);
+    for (const char* id : {"x", "y", "z"})
+    {
+        auto t = s.tryGetNext();
+        CHECK(t && t->task_id == id);
+        if (t) s.complete(t->task_id);
+    }
+    CHECK(s.empty() && s.blockedSize() == 0);
+}
+
+// --------- Shared memory ---------
+
+// A consumer process dies holding a task: reap() puts it back at the front of its lane,
+// ahead of the tasks that were queued behind it.
+void shmConsumerCrashReaped()
+{
+    const std::string name = "/scheduler_tests_" + std::to_string(::getpid());
+    ShmTaskQueue::remove(name);
+    auto q = ShmTaskQueue::create(name, ShmQueueOptions{ShmQueueMode::Fifo, 16, 1, 4});
+    CHECK(q);
+    if (!q) return;
+    CHECK(q->submit(makeTask("A")));
+    CHECK(q->submit(makeTask("B")));
+
+    const pid_t child = ::fork();
+    if (child == 0)
+    {
+        auto c = ShmTaskQueue::open(name);
+        auto t = c ? c->getNext() : std::nullopt;
+        ::_exit(t && t->task_id == "A" ? 0 : 1); // no destructor: the task stays in flight
+    }
+    int status = 0;
+    CHECK(child > 0 && ::waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    CHECK(q->size() == 1);
+    CHECK(q->reap() == 1);
+    CHECK(q->reap() == 0);
+    CHECK(q->size() == 2);
+    auto a = q->tryGetNext();
+    auto b = q->tryGetNext(); // acknowledges A
+    CHECK(a && a->task_id == "A" && b && b->task_id == "B");
+    CHECK(q->complete());
+    CHECK(!q->complete());
+    CHECK(q->empty());
+
+    q->shutdown();
+    CHECK(!q->submit(makeTask("late")));
+    CHECK(ShmTaskQueue::remove(name));
+}
+
+// --------- Coroutines ---------
+
+#if defined(__cpp_impl_coroutine)
+Detached countTasks(FairTaskScheduler<>& s, CoroExecutor& ex, std::atomic<int>& got, std::atomic<int>& exited)
+{
+    while (auto t = co_await s.next(ex)) got.fetch_add(1);
+    exited.fetch_add(1);
+}
+#endif
+
+// Coroutine consumers get queued and delayed tasks; shutdown() resumes every parked one
+// with nullopt, so join() returns. Only built as C++20.
+void coroShutdown()
+{
+#if defined(__cpp_impl_coroutine)
+    constexpr int kConsumers = 4, kTasks = 200;
+    FairTaskScheduler<> s;
+    std::atomic<int> got{0}, exited{0};
+    {
+        CoroExecutor ex(2);
+        ex.drive(s);
+        for (int i = 0; i < kConsumers; ++i) ex.spawn(countTasks(s, ex, got, exited));
+        for (int i = 0; i < kTasks; ++i)
+            s.submit(makeTask(std::to_string(i), "t" + std::to_string(i % 3)));
+        s.submitAfter(makeTask("late"), std::chrono::milliseconds(5));
+
+        const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (got.load() < kTasks + 1 && std::chrono::steady_clock::now() < give_up)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(got.load() == kTasks + 1);
+        CHECK(exited.load() == 0);
+
+        s.shutdown();
+        ex.join();
+    }
+    CHECK(exited.load() == kConsumers);
+    CHECK(s.empty() && s.delayedSize() == 0);
+#endif
+}
+
+// --------- Metrics ---------
+
+void metricsShardsRetired()
+{
+#ifndef SCHED_NO_METRICS
+    // One thread recording into more registries than it caches: the least recently used
+    // shards are folded back as it goes, and the rest when it exits. No count is lost.
+    std::vector<std::unique_ptr<metrics::Registry>> regs;
+    for (int i = 0; i < 20; ++i) regs.push_back(std::make_unique<metrics::Registry>());
+    std::size_t liveWhileRunning = 0;
+    std::thread worker([&] {
+        for (int round = 0; round < 3; ++round)
+            for (auto& r : regs)
+            {
+                r->add(metrics::Counter::Submitted, 2);
+                r->record(metrics::Histogram::LockWaitNs, 100);
+            }
+        for (auto& r : regs) liveWhileRunning += r->shardCount();
+    });
+    worker.join();
+
+    CHECK(liveWhileRunning <= 8);
+    for (auto& r : regs)
+    {
+        CHECK(r->shardCount() == 0);
+        const metrics::Snapshot snap = r->snapshot();
+        CHECK(snap[metrics::Counter::Submitted] == 6);
+        CHECK(snap[metrics::Histogram::LockWaitNs].count == 3);
+        CHECK(snap[metrics::Histogram::LockWaitNs].max == 100);
+    }
+
+    // A thread that outlives a registry it recorded into exits cleanly.
+    auto gone = std::make_unique<metrics::Registry>();
+    std::atomic<bool> recorded{false}, destroyed{false};
+    std::thread late([&] {
+        gone->add(metrics::Counter::Dequeued);
+        recorded = true;
+        while (!destroyed.load()) std::this_thread::yield();
+    });
+    while (!recorded.load()) std::this_thread::yield();
+    gone.reset();
+    destroyed = true;
+    late.join();
+#endif
+}
+
+void prometheusLabelEscaping()
+{
+    metrics::Snapshot snap;
+    snap.depth.push_back({"a\"b\\c\nd", -1, 3});
+    const std::string text = metrics::toPrometheus(snap, "s\"1");
+    CHECK(text.find("sched_submitted_total{scheduler=\"s\\\"1\"} 0\n") != std::string::npos);
+    CHECK(text.find("sched_queue_depth{scheduler=\"s\\\"1\",tenant=\"a\\\"b\\\\c\\nd\"} 3\n") !=
+          std::string::npos);
+}
+
+struct TestCase
+{
+    const char* name;
+    void (*fn)();
+};
+
+const TestCase kTests[] = {
+    {"fifo_order_per_backend", fifoOrderPerBackend},
+    {"fifo_cancel_size", fifoCancelSize},
+    {"stealing_size_never_wraps", stealingSizeNeverWraps},
+    {"fifo_stress_per_backend", fifoStressPerBackend},
+    {"delayed_release", delayedRelease},
+    {"fair_cancel_size", fairCancelSize},
+    {"fair_round_robin", fairRoundRobin},
+    {"fair_drr_weights", fairDrrWeights},
+    {"rate_limit_parks_tenant", rateLimitParksTenant},
+    {"priority_cancel_size", priorityCancelSize},
+    {"edf_order", edfOrder},
+    {"edf_aging", edfAging},
+    {"retry_to_dead_letter", retryToDeadLetter},
+    {"wal_replay_after_truncation", walReplayAfterTruncation},
+    {"wal_compaction_crash", walCompactionCrash},
+    {"wal_failure_reported", walFailureReported},
+    {"wal_failure_stops_buffering", walFailureStopsBuffering},
+    {"dependency_release", dependencyRelease},
+    {"dependency_cycle_rejected", dependencyCycleRejected},
+    {"complete_before_dispatch", completeBeforeDispatch},
+    {"shm_consumer_crash_reaped", shmConsumerCrashReaped},
+    {"coro_shutdown", coroShutdown},
+    {"metrics_shards_retired", metricsShardsRetired},
+    {"prometheus_label_escaping", prometheusLabelEscaping},
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+    int failed = 0, ran = 0;
+    for (const TestCase& test : kTests)
+    {
+        if (!std::strstr(test.name, filter)) continue;
+        const int before = failures;
+        test.fn();
+        ++ran;
+        const bool ok = failures == before;
+        if (!ok) ++failed;
+        std::cout << (ok ? "[ ok ] " : "[FAIL] ") << test.name << "\n";
+    }
+    std::cout << ran - failed << "/" << ran << " passed\n";
+    return failed ? 1 : 0;
+}
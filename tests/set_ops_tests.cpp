@@ -0,0 +1,183 @@
+// set_ops_tests.cpp
+// C++17, STL only
+//
+// Assertion tests for sorted_set_ops.h: every kernel set the CPU runs and every
+// intersection strategy against the STL algorithms, on random lists of interleaved and
+// skewed sizes (so both the linear and the lookup paths run) and on edge cases.
+//
+//   ./set_ops_tests              run every test
+//   ./set_ops_tests merge        run the tests whose name contains "merge"
+//
+// CHECK reports file:line and keeps going; the exit status is 1 if any test failed.
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "sorted_set_ops.h"
+
+namespace
+{
+
+int failures = 0;
+
+#define CHECK(cond)                                                                       \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(cond))                                                                      \
+        {                                                                                 \
+            std::cerr << "  " << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed\n"; \
+            ++failures;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+using setops::Isa;
+using setops::Strategy;
+
+const Isa kIsas[] = {Isa::Scalar, Isa::Sse41, Isa::Avx2}; // clamped to what the CPU has
+const Strategy kStrategies[] = {Strategy::Auto, Strategy::Linear, Strategy::Galloping, Strategy::BinaryProbe};
+
+// `n` distinct sorted values out of [0, range).
+std::vector<int> randomSet(std::mt19937& rng, std::size_t n, int range)
+{
+    std::set<int> s;
+    std::uniform_int_distribution<int> pick(0, range - 1);
+    while (s.size() < n) s.insert(pick(rng));
+    return std::vector<int>(s.begin(), s.end());
+}
+
+// `n` sorted values out of [0, range), repeats allowed.
+std::vector<int> randomList(std::mt19937& rng, std::size_t n, int range)
+{
+    std::vector<int> v(n);
+    std::uniform_int_distribution<int> pick(0, range - 1);
+    for (int& x : v) x = pick(rng);
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+std::vector<int> stlIntersection(const std::vector<int>& a, const std::vector<int>& b)
+{
+    std::vector<int> out;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
+
+// (size of a, size of b): equal, a few times apart, and past the lookup thresholds.
+const std::pair<std::size_t, std::size_t> kSizes[] = {
+    {0, 0}, {0, 50}, {1, 1}, {7, 9}, {33, 31}, {100, 100}, {1000, 1000},
+    {200, 3000}, {40, 5000}, {10, 20000}, {3000, 90},
+};
+
+void intersectSetsMatchesStl()
+{
+    std::mt19937 rng(1);
+    for (auto [m, n] : kSizes)
+    {
+        for (int range : {static_cast<int>(2 * (m + n) + 1), 1 << 20})
+        {
+            const std::vector<int> a = randomSet(rng, m, std::max(range, static_cast<int>(m))),
+                                   b = randomSet(rng, n, std::max(range, static_cast<int>(n)));
+            const std::vector<int> want = stlIntersection(a, b);
+            for (Isa isa : kIsas)
+                for (Strategy s : kStrategies)
+                {
+                    std::vector<int> out(setops::intersectCapacity(a, b));
+                    out.resize(setops::intersectSets(a, b, out.data(), s, isa));
+                    CHECK(out == want);
+                }
+        }
+    }
+
+    // Identical and disjoint lists.
+    const std::vector<int> a = randomSet(rng, 500, 5000);
+    std::vector<int> shifted(a.size());
+    std::transform(a.begin(), a.end(), shifted.begin(), [](int x) { return x + 10000; });
+    for (Isa isa : kIsas)
+    {
+        std::vector<int> out(setops::intersectCapacity(a, a));
+        out.resize(setops::intersectSets(a, a, out.data(), Strategy::Auto, isa));
+        CHECK(out == a);
+        out.assign(setops::intersectCapacity(a, shifted), 0);
+        CHECK(setops::intersectSets(a, shifted, out.data(), Strategy::Auto, isa) == 0);
+    }
+}
+
+void intersectWithRepeatsMatchesStl()
+{
+    std::mt19937 rng(2);
+    for (auto [m, n] : kSizes)
+    {
+        const std::vector<int> a = randomList(rng, m, 64), b = randomList(rng, n, 64);
+        for (Strategy s : kStrategies) CHECK(setops::intersect(a, b, s) == stlIntersection(a, b));
+    }
+}
+
+void intersectManyMatchesStl()
+{
+    std::mt19937 rng(3);
+    std::vector<std::vector<int>> lists = {randomSet(rng, 4000, 8000), randomSet(rng, 300, 8000),
+                                           randomSet(rng, 6000, 8000), randomSet(rng, 2000, 8000)};
+    std::vector<int> want = lists[0];
+    for (std::size_t i = 1; i < lists.size(); ++i) want = stlIntersection(want, lists[i]);
+
+    std::vector<setops::IntSpan> spans(lists.begin(), lists.end());
+    CHECK(setops::intersectMany(spans) == want);
+    CHECK(setops::intersectMany({}).empty());
+    CHECK(setops::intersectMany({lists[1]}) == lists[1]);
+
+    // A list with nothing in common ends the walk empty.
+    const std::vector<int> none = {-5, -3, -1};
+    spans.push_back(none);
+    CHECK(setops::intersectMany(spans).empty());
+}
+
+void mergeMatchesStl()
+{
+    std::mt19937 rng(4);
+    for (auto [m, n] : kSizes)
+    {
+        const std::vector<int> a = randomList(rng, m, 1 << 16), b = randomList(rng, n, 1 << 16);
+        std::vector<int> want;
+        std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(want));
+        for (Isa isa : kIsas) CHECK(setops::merge(a, b, isa) == want);
+    }
+}
+
+struct TestCase
+{
+    const char* name;
+    void (*fn)();
+};
+
+const TestCase kTests[] = {
+    {"intersect_sets_matches_stl", intersectSetsMatchesStl},
+    {"intersect_with_repeats_matches_stl", intersectWithRepeatsMatchesStl},
+    {"intersect_many_matches_stl", intersectManyMatchesStl},
+    {"merge_matches_stl", mergeMatchesStl},
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+    int failed = 0, ran = 0;
+    for (const TestCase& test : kTests)
+    {
+        if (!std::strstr(test.name, filter)) continue;
+        const int before = failures;
+        test.fn();
+        ++ran;
+        const bool ok = failures == before;
+        if (!ok) ++failed;
+        std::cout << (ok ? "[ ok ] " : "[FAIL] ") << test.name << "\n";
+    }
+    std::cout << ran - failed << "/" << ran << " passed\n";
+    return failed ? 1 : 0;
+}